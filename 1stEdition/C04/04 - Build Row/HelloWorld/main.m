@@ -31,7 +31,7 @@ UIColor *randomColor()
     return theColor;
 }
 
-#define IS_HORIZONTAL_ALIGNMENT(ALIGNMENT) [@[@(NSLayoutFormatAlignAllLeft), @(NSLayoutFormatAlignAllRight), @(NSLayoutFormatAlignAllLeading), @(NSLayoutFormatAlignAllTrailing), @(NSLayoutFormatAlignAllCenterX), ] containsObject:@(ALIGNMENT)]
+#define IS_HORIZONTAL_ALIGNMENT(ALIGNMENT) (((ALIGNMENT) & (NSLayoutFormatAlignAllLeft | NSLayoutFormatAlignAllRight | NSLayoutFormatAlignAllLeading | NSLayoutFormatAlignAllTrailing | NSLayoutFormatAlignAllCenterX)) != 0)
 
 void buildLineWithSpacing(NSArray *views, NSLayoutFormatOptions alignment, NSString *spacing, NSUInteger priority)
 {
@@ -48,7 +48,7 @@ void matchSizes(NSArray *views, NSInteger axis, NSUInteger priority)
     }
 }
 
-#define IS_HORIZONTAL_ALIGNMENT(ALIGNMENT) [@[@(NSLayoutFormatAlignAllLeft), @(NSLayoutFormatAlignAllRight), @(NSLayoutFormatAlignAllLeading), @(NSLayoutFormatAlignAllTrailing), @(NSLayoutFormatAlignAllCenterX), ] containsObject:@(ALIGNMENT)]
+#define IS_HORIZONTAL_ALIGNMENT(ALIGNMENT) (((ALIGNMENT) & (NSLayoutFormatAlignAllLeft | NSLayoutFormatAlignAllRight | NSLayoutFormatAlignAllLeading | NSLayoutFormatAlignAllTrailing | NSLayoutFormatAlignAllCenterX)) != 0)
 
 void buildLineWithSpacing(NSArray *views, NSLayoutFormatOptions alignment, NSString *spacing, NSUInteger priority)
 {
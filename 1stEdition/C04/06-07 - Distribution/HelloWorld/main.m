@@ -11,7 +11,7 @@
 #import "ConstraintUtilities-Install.h"
 
 #define ORANGE_COLOR    [UIColor colorWithRed:1.0f green:0.6f blue:0.0f alpha:1.0f]
-#define IS_HORIZONTAL_ALIGNMENT(ALIGNMENT) [@[@(NSLayoutFormatAlignAllLeft), @(NSLayoutFormatAlignAllRight), @(NSLayoutFormatAlignAllLeading), @(NSLayoutFormatAlignAllTrailing), @(NSLayoutFormatAlignAllCenterX), ] containsObject:@(ALIGNMENT)]
+#define IS_HORIZONTAL_ALIGNMENT(ALIGNMENT) (((ALIGNMENT) & (NSLayoutFormatAlignAllLeft | NSLayoutFormatAlignAllRight | NSLayoutFormatAlignAllLeading | NSLayoutFormatAlignAllTrailing | NSLayoutFormatAlignAllCenterX)) != 0)
 
 NSLayoutAttribute attributeForAlignment(NSLayoutFormatOptions alignment)
 {
@@ -131,9 +131,17 @@
 
 #pragma mark - Format Description
 
-#define IS_LEADING_ATTRIBUTE(_ATTRIBUTE_) [@[@(NSLayoutAttributeTop), @(NSLayoutAttributeLeading), @(NSLayoutAttributeLeft)] containsObject:@(_ATTRIBUTE_)]
-#define IS_TRAILING_ATTRIBUTE(_ATTRIBUTE_) [@[@(NSLayoutAttributeBottom), @(NSLayoutAttributeTrailing), @(NSLayoutAttributeRight)] containsObject:@(_ATTRIBUTE_)]
-#define IS_UNSUPPORTED_ATTRIBUTE(_ATTRIBUTE_) [@[@(NSLayoutAttributeLeft), @(NSLayoutAttributeRight), @(NSLayoutAttributeBaseline)] containsObject:@(_ATTRIBUTE_)]
+// Visual formats cannot express left, right or baseline
+static inline BOOL ConstraintAttributeUnsupportedInFormat(NSLayoutAttribute attribute)
+{
+    if ((attribute == NSLayoutAttributeLeft) || (attribute == NSLayoutAttributeRight))
+        return YES;
+    return ConstraintAttributeHasTrait(attribute, ConstraintTraitBaseline);
+}
+
+#define IS_LEADING_ATTRIBUTE(_ATTRIBUTE_) ConstraintAttributeHasTrait(_ATTRIBUTE_, ConstraintTraitLeading)
+#define IS_TRAILING_ATTRIBUTE(_ATTRIBUTE_) ConstraintAttributeHasTrait(_ATTRIBUTE_, ConstraintTraitTrailing)
+#define IS_UNSUPPORTED_ATTRIBUTE(_ATTRIBUTE_) ConstraintAttributeUnsupportedInFormat(_ATTRIBUTE_)
 
 @implementation NSLayoutConstraint (FormatDescription)
 
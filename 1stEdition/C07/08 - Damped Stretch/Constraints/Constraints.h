@@ -26,8 +26,8 @@
  *
  */
 
-#define IS_VALID_RELATION(RELATION) [@[@(NSLayoutFormatAlignAllTop), @(NSLayoutRelationEqual), @(NSLayoutRelationGreaterThanOrEqual)] containsObject:@(RELATION)]
-#define IS_VALID_ATTRIBUTE(ATTRIBUTE) [@[@(NSLayoutAttributeWidth), @(NSLayoutAttributeHeight), @(NSLayoutAttributeCenterX), @(NSLayoutAttributeCenterY), @(NSLayoutAttributeLeft), @(NSLayoutAttributeRight), @(NSLayoutAttributeTop), @(NSLayoutAttributeBottom), @(NSLayoutAttributeLeading), @(NSLayoutAttributeTrailing), @(NSLayoutAttributeBaseline)] containsObject:@(ATTRIBUTE)]
+#define IS_VALID_RELATION(RELATION) (((RELATION) >= NSLayoutRelationLessThanOrEqual) && ((RELATION) <= NSLayoutRelationGreaterThanOrEqual))
+#define IS_VALID_ATTRIBUTE(ATTRIBUTE) (((ATTRIBUTE) >= NSLayoutAttributeLeft) && ((ATTRIBUTE) <= NSLayoutAttributeBaseline))
 
 
 /*
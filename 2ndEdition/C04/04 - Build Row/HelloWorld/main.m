@@ -31,7 +31,101 @@ UIColor *randomColor()
     return theColor;
 }
 
-#define IS_HORIZONTAL_ALIGNMENT(ALIGNMENT) [@[@(NSLayoutFormatAlignAllLeft), @(NSLayoutFormatAlignAllRight), @(NSLayoutFormatAlignAllLeading), @(NSLayoutFormatAlignAllTrailing), @(NSLayoutFormatAlignAllCenterX), ] containsObject:@(ALIGNMENT)]
+/*
+ ATTRIBUTE TRAITS
+ A static table, indexed by NSLayoutAttribute, answers the questions
+ the IS_* macros ask: axis, kind, which side, margin or not. Alignment
+ options are single attribute bits (1 << attribute), so the same table
+ serves NSLayoutFormatOptions. A lookup is a bounds check and a mask.
+ */
+
+#ifndef CONSTRAINT_ATTRIBUTE_TRAITS
+#define CONSTRAINT_ATTRIBUTE_TRAITS
+
+typedef enum
+{
+    ConstraintTraitHorizontal = 1 << 0,
+    ConstraintTraitVertical = 1 << 1,
+    ConstraintTraitSize = 1 << 2,
+    ConstraintTraitEdge = 1 << 3,
+    ConstraintTraitCenter = 1 << 4,
+    ConstraintTraitLeading = 1 << 5,    // Top, left or leading side
+    ConstraintTraitTrailing = 1 << 6,   // Bottom, right or trailing side
+    ConstraintTraitBaseline = 1 << 7,
+    ConstraintTraitMargin = 1 << 8,     // iOS 8 margin attributes
+} ConstraintAttributeTrait;
+
+// Raw values past baseline, so the table builds on SDKs
+// that predate the iOS 8 attributes
+#define CONSTRAINT_TRAIT_ATTRIBUTES 21
+
+static const uint16_t ConstraintAttributeTraitTable[CONSTRAINT_TRAIT_ATTRIBUTES] = {
+    [NSLayoutAttributeLeft] = ConstraintTraitHorizontal | ConstraintTraitEdge | ConstraintTraitLeading,
+    [NSLayoutAttributeRight] = ConstraintTraitHorizontal | ConstraintTraitEdge | ConstraintTraitTrailing,
+    [NSLayoutAttributeTop] = ConstraintTraitVertical | ConstraintTraitEdge | ConstraintTraitLeading,
+    [NSLayoutAttributeBottom] = ConstraintTraitVertical | ConstraintTraitEdge | ConstraintTraitTrailing,
+    [NSLayoutAttributeLeading] = ConstraintTraitHorizontal | ConstraintTraitEdge | ConstraintTraitLeading,
+    [NSLayoutAttributeTrailing] = ConstraintTraitHorizontal | ConstraintTraitEdge | ConstraintTraitTrailing,
+    [NSLayoutAttributeWidth] = ConstraintTraitHorizontal | ConstraintTraitSize,
+    [NSLayoutAttributeHeight] = ConstraintTraitVertical | ConstraintTraitSize,
+    [NSLayoutAttributeCenterX] = ConstraintTraitHorizontal | ConstraintTraitCenter,
+    [NSLayoutAttributeCenterY] = ConstraintTraitVertical | ConstraintTraitCenter,
+    [NSLayoutAttributeBaseline] = ConstraintTraitVertical | ConstraintTraitEdge | ConstraintTraitBaseline,
+    [12] = ConstraintTraitVertical | ConstraintTraitEdge | ConstraintTraitBaseline, // First baseline
+    [13] = ConstraintTraitHorizontal | ConstraintTraitEdge | ConstraintTraitLeading | ConstraintTraitMargin, // Left margin
+    [14] = ConstraintTraitHorizontal | ConstraintTraitEdge | ConstraintTraitTrailing | ConstraintTraitMargin, // Right margin
+    [15] = ConstraintTraitVertical | ConstraintTraitEdge | ConstraintTraitLeading | ConstraintTraitMargin, // Top margin
+    [16] = ConstraintTraitVertical | ConstraintTraitEdge | ConstraintTraitTrailing | ConstraintTraitMargin, // Bottom margin
+    [17] = ConstraintTraitHorizontal | ConstraintTraitEdge | ConstraintTraitLeading | ConstraintTraitMargin, // Leading margin
+    [18] = ConstraintTraitHorizontal | ConstraintTraitEdge | ConstraintTraitTrailing | ConstraintTraitMargin, // Trailing margin
+    [19] = ConstraintTraitHorizontal | ConstraintTraitCenter | ConstraintTraitMargin, // Center X within margins
+    [20] = ConstraintTraitVertical | ConstraintTraitCenter | ConstraintTraitMargin, // Center Y within margins
+};
+
+static inline NSUInteger ConstraintAttributeTraits(NSLayoutAttribute attribute)
+{
+    if ((attribute < 0) || (attribute >= CONSTRAINT_TRAIT_ATTRIBUTES))
+        return 0;
+    return ConstraintAttributeTraitTable[attribute];
+}
+
+// YES when the attribute has any of the traits
+static inline BOOL ConstraintAttributeHasTrait(NSLayoutAttribute attribute, NSUInteger traits)
+{
+    return (ConstraintAttributeTraits(attribute) & traits) != 0;
+}
+
+// The attribute an alignment option names, if it names exactly one
+static inline NSLayoutAttribute ConstraintAlignmentAttribute(NSLayoutFormatOptions alignment)
+{
+    if (!alignment || (alignment & (alignment - 1)))
+        return NSLayoutAttributeNotAnAttribute;
+    return (NSLayoutAttribute) __builtin_ctzll(alignment);
+}
+
+// Sizes cannot be aligned, so size bits never match
+static inline BOOL ConstraintAlignmentHasTrait(NSLayoutFormatOptions alignment, NSUInteger traits)
+{
+    NSUInteger attributeTraits = ConstraintAttributeTraits(ConstraintAlignmentAttribute(alignment));
+    if (attributeTraits & ConstraintTraitSize)
+        return NO;
+    return (attributeTraits & traits) != 0;
+}
+
+// The eleven attributes that predate iOS 8
+static inline BOOL ConstraintAttributeIsValid(NSLayoutAttribute attribute)
+{
+    return (attribute >= NSLayoutAttributeLeft) && (attribute <= NSLayoutAttributeBaseline);
+}
+
+static inline BOOL ConstraintRelationIsValid(NSLayoutRelation relation)
+{
+    return (relation >= NSLayoutRelationLessThanOrEqual) && (relation <= NSLayoutRelationGreaterThanOrEqual);
+}
+
+#endif
+
+#define IS_HORIZONTAL_ALIGNMENT(ALIGNMENT) ConstraintAlignmentHasTrait(ALIGNMENT, ConstraintTraitHorizontal)
 
 void buildLineWithSpacing(NSArray *views, NSLayoutFormatOptions alignment, NSString *spacing, NSUInteger priority)
 {
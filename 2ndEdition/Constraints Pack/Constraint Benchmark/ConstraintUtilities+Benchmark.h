@@ -0,0 +1,78 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#if TARGET_OS_IPHONE
+@import Foundation;
+#elif TARGET_OS_MAC
+#import <Foundation/Foundation.h>
+#endif
+
+#import "ConstraintPack.h"
+
+/*
+ CONSTRAINT BENCHMARKS
+ Times pack routines over synthetic view trees and reports the
+ results as JSON, so runs can be saved and compared for regressions.
+ 
+ This is a debugging tool. It is deliberately left out of
+ ConstraintPack.h. Add it to a test or debug target, run it on a
+ device or the simulator (UIKit and AppKit views are real views),
+ and keep the output. For example:
+ 
+    NSString *json = RunConstraintPackBenchmarks(BENCHMARK_DEFAULT_SIZES, 5);
+    [json writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:nil];
+ */
+
+typedef enum
+{
+    BenchmarkShapeDeepChain = 0,    // Each view inside the last
+    BenchmarkShapeWideFan,          // Every view a child of the root
+    BenchmarkShapeGrid,             // Rows of cells, roughly square
+    BenchmarkShapeCellClones,       // Repeated five-view table cells
+    BenchmarkShapeCount,
+} BenchmarkTreeShape;
+
+#define BENCHMARK_DEFAULT_SIZES @[@10, @100, @1000, @10000]
+
+// Build a tree with about viewCount views, root included
+VIEW_CLASS *BuildBenchmarkTree(BenchmarkTreeShape shape, NSUInteger viewCount);
+
+// Uninstalled constraints for a benchmark tree: each view sized,
+// placed after its previous sibling or else inside its parent
+NSArray *BenchmarkConstraintsForTree(VIEW_CLASS *root);
+
+NSString *NameForBenchmarkShape(BenchmarkTreeShape shape);
+
+// Run every case against every shape at each size. Each timing is
+// the median of the given number of iterations, in microseconds
+NSString *RunConstraintPackBenchmarks(NSArray *viewCounts, NSUInteger iterations);
+
+// Tag constraintCount constraints from a small vocabulary and compare
+// the string bytes they hold against one private copy per constraint.
+// New atom table entries count against the savings. Try 10000
+NSString *NametagMemoryReport(NSUInteger constraintCount);
+
+// Generate constraints for rowCount table-style rows, five formats
+// per row, through the system parser and through format templates,
+// cold and warm. Try 1000
+NSString *VisualFormatRowReport(NSUInteger rowCount);
+
+// Dump a grid tree's constraints with visualFormat, replay each
+// format and compare it with its constraint, then time parses of
+// the whole dump. The parser is plain C, so the parse timing also
+// runs anywhere VisualFormatDialect.c builds. Try 1000 and 100
+NSString *VisualFormatDialectReport(NSUInteger viewCount, NSUInteger parses);
+
+// Time BuildLine, MatchSizesH and PseudoDistributeWithSpacers on
+// rows of each size against their old per-pair format parsing.
+// Try @[@10, @100, @1000, @10000]
+NSString *LayoutLineReport(NSArray *viewCounts);
+
+// Lay out three-column grids the way the Grids sample does and with
+// BuildGrid(), comparing install time and constraint counts. The
+// sample's count includes its spacers. Counts round down to whole
+// three-view rows, so @[@100, @2500] runs 99 and 2,499 cells
+NSString *GridReport(NSArray *cellCounts);
@@ -0,0 +1,1044 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#import "ConstraintUtilities+Benchmark.h"
+#import <mach/mach_time.h>
+#import <malloc/malloc.h>
+
+#define BENCHMARK_NAMETAG @"Benchmark"
+
+// Views per table cell clone: content view plus four items
+#define BENCHMARK_CELL_VIEWS 5
+
+#pragma mark - Timing
+
+// Microseconds on the mach clock
+static double BenchmarkNow(void)
+{
+    static mach_timebase_info_data_t timebase;
+    if (!timebase.denom)
+        mach_timebase_info(&timebase);
+    return (double) mach_absolute_time() * timebase.numer / timebase.denom / 1000.0;
+}
+
+static double BenchmarkTime(void (^block)(void))
+{
+    double start = BenchmarkNow();
+    block();
+    return BenchmarkNow() - start;
+}
+
+#pragma mark - Trees
+
+NSString *NameForBenchmarkShape(BenchmarkTreeShape shape)
+{
+    switch (shape)
+    {
+        case BenchmarkShapeDeepChain: return @"deepChain";
+        case BenchmarkShapeWideFan: return @"wideFan";
+        case BenchmarkShapeGrid: return @"grid";
+        case BenchmarkShapeCellClones: return @"cellClones";
+        default: return @"unknown";
+    }
+}
+
+static VIEW_CLASS *BenchmarkView(VIEW_CLASS *parent)
+{
+    VIEW_CLASS *view = [[VIEW_CLASS alloc] initWithFrame:CGRectMake(0, 0, 20, 20)];
+    PREPCONSTRAINTS(view);
+    [parent addSubview:view];
+    return view;
+}
+
+VIEW_CLASS *BuildBenchmarkTree(BenchmarkTreeShape shape, NSUInteger viewCount)
+{
+    VIEW_CLASS *root = BenchmarkView(nil);
+    root.nametag = @"Root";
+    NSUInteger remaining = (viewCount > 1) ? viewCount - 1 : 0;
+    
+    switch (shape)
+    {
+        case BenchmarkShapeDeepChain:
+        {
+            VIEW_CLASS *parent = root;
+            while (remaining--)
+                parent = BenchmarkView(parent);
+            break;
+        }
+        case BenchmarkShapeWideFan:
+        {
+            while (remaining--)
+                BenchmarkView(root);
+            break;
+        }
+        case BenchmarkShapeGrid:
+        {
+            // Each row view counts against the total
+            NSUInteger columns = MAX(1, (NSUInteger) sqrt(remaining));
+            while (remaining)
+            {
+                VIEW_CLASS *row = BenchmarkView(root);
+                remaining--;
+                for (NSUInteger column = 0; column < columns && remaining; column++, remaining--)
+                    BenchmarkView(row);
+            }
+            break;
+        }
+        case BenchmarkShapeCellClones:
+        {
+            while (remaining)
+            {
+                VIEW_CLASS *cell = BenchmarkView(root);
+                remaining--;
+                for (NSUInteger item = 1; item < BENCHMARK_CELL_VIEWS && remaining; item++, remaining--)
+                    BenchmarkView(cell);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    
+    return root;
+}
+
+NSArray *BenchmarkConstraintsForTree(VIEW_CLASS *root)
+{
+    NSMutableArray *constraints = [NSMutableArray array];
+    [root enumerateSubtreeWithOptions:ViewTraversalSkipRoot maxDepth:ViewTraversalNoDepthLimit usingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        VIEW_CLASS *parent = view.superview;
+        NSUInteger index = [parent.subviews indexOfObjectIdenticalTo:view];
+    
+        // Fixed size
+        [constraints addObject:[NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeWidth relatedBy:NSLayoutRelationEqual toItem:nil attribute:NSLayoutAttributeNotAnAttribute multiplier:1 constant:20]];
+        [constraints addObject:[NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeHeight relatedBy:NSLayoutRelationEqual toItem:nil attribute:NSLayoutAttributeNotAnAttribute multiplier:1 constant:20]];
+    
+        // Follow the previous sibling, or start inside the parent
+        if (index > 0)
+            [constraints addObject:[NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeLeading relatedBy:NSLayoutRelationEqual toItem:parent.subviews[index - 1] attribute:NSLayoutAttributeTrailing multiplier:1 constant:AQUA_SPACE]];
+        else
+            [constraints addObject:[NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeLeading relatedBy:NSLayoutRelationEqual toItem:parent attribute:NSLayoutAttributeLeading multiplier:1 constant:1]];
+        [constraints addObject:[NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeTop relatedBy:NSLayoutRelationEqual toItem:parent attribute:NSLayoutAttributeTop multiplier:1 constant:1]];
+    }];
+    return constraints;
+}
+
+#pragma mark - Fixtures
+
+// One tree per shape and size, shared by the cases
+@interface ConstraintBenchmarkFixture : NSObject
+@property (nonatomic) BenchmarkTreeShape shape;
+@property (nonatomic) NSUInteger viewCount;
+@property (nonatomic, strong) VIEW_CLASS *root;
+@property (nonatomic, strong) NSArray *views;        // pre-order, root first
+@property (nonatomic, strong) NSArray *constraints;  // as installed
+@end
+
+@implementation ConstraintBenchmarkFixture
++ (instancetype) fixtureWithShape: (BenchmarkTreeShape) shape viewCount: (NSUInteger) viewCount install: (BOOL) install
+{
+    ConstraintBenchmarkFixture *fixture = [[self alloc] init];
+    fixture.shape = shape;
+    fixture.viewCount = viewCount;
+    fixture.root = BuildBenchmarkTree(shape, viewCount);
+    fixture.views = [@[fixture.root] arrayByAddingObjectsFromArray:fixture.root.allSubviews];
+    fixture.constraints = BenchmarkConstraintsForTree(fixture.root);
+    if (install)
+        InstallConstraints(fixture.constraints, 0, BENCHMARK_NAMETAG);
+    return fixture;
+}
+
+- (VIEW_CLASS *) deepestView
+{
+    return self.views.lastObject;
+}
+@end
+
+#pragma mark - Cases
+
+// A case times one iteration. Untimed setup happens inside the case,
+// around its call to BenchmarkTime
+typedef double (^BenchmarkCaseBlock)(ConstraintBenchmarkFixture *fixture);
+
+typedef struct
+{
+    __unsafe_unretained NSString *name;
+    BOOL needsFreshTree;        // rebuild, uninstalled, every iteration
+    NSUInteger deepChainLimit;  // skip deep chains above this size, 0 for none
+} BenchmarkCaseInfo;
+
+static const BenchmarkCaseInfo BenchmarkCases[] = {
+    {@"InstallConstraints", YES, 0},
+    {@"nearestCommonAncestorToViewLegacy", NO, 0},
+    {@"nearestCommonAncestorToView", NO, 0},
+    {@"constraintsNamed", NO, 0},
+    {@"ConstraintQuery", NO, 0},
+    {@"cachedConstraintNamed", NO, 0},
+    {@"constraintsMatchingConstraints", NO, 0},
+    {@"constraintsReferencingViewAndView", NO, 0},
+    {@"allSubviews", NO, 0},
+    {@"autoAddConstraintNames", NO, 0},
+    {@"viewTree", NO, 1000}, // output grows with depth squared
+    {@"sourceTypeLegacy", NO, 0},
+    {@"sourceType", NO, 0},
+    {@"stringValueReport", NO, 0},
+    {@"isAncestorOfViewLegacy", NO, 0},
+    {@"isAncestorOfView", NO, 0},
+    {@"depthInHierarchy", NO, 0},
+    {@"teardownPerView", YES, 0},
+    {@"removeConstraintsReferencingSubtree", YES, 0},
+    {@"removeConstraintsNamedLegacy", YES, 0},
+    {@"removeSubtreeConstraintsNamed", YES, 0},
+    {@"PlanConstraintsInSubtree", NO, 0},
+    {@"attributeTestsLegacy", NO, 0},
+    {@"attributeTests", NO, 0},
+};
+
+// The IS_* tests before the trait table, kept as a baseline
+#define LEGACY_IS_HORIZONTAL_ATTRIBUTE(ATTRIBUTE) [@[@(NSLayoutAttributeLeft), @(NSLayoutAttributeRight), @(NSLayoutAttributeLeading), @(NSLayoutAttributeTrailing), @(NSLayoutAttributeCenterX), @(NSLayoutAttributeWidth)] containsObject:@(ATTRIBUTE)]
+#define LEGACY_IS_SIZE_ATTRIBUTE(ATTRIBUTE) [@[@(NSLayoutAttributeWidth), @(NSLayoutAttributeHeight)] containsObject:@(ATTRIBUTE)]
+#define LEGACY_IS_CENTER_ATTRIBUTE(ATTRIBUTE) [@[@(NSLayoutAttributeCenterX), @(NSLayoutAttributeCenterY)] containsObject:@(ATTRIBUTE)]
+
+// The classification sourceType used before it was cached, kept as a baseline
+static ConstraintSourceType LegacySourceType(NSLayoutConstraint *constraint)
+{
+    ConstraintSourceType result = ConstraintSourceTypeCustom;
+    if (constraint.shouldBeArchived)
+    {
+        result = ConstraintSourceTypeSatisfaction;
+        NSString *description = constraint.debugDescription;
+        if ([description rangeOfString:@"ambiguity"].location != NSNotFound)
+            result = ConstraintSourceTypeDisambiguation;
+        else if ([description rangeOfString:@"fixed frame"].location != NSNotFound)
+            result = ConstraintSourceTypeInferred;
+    }
+    return result;
+}
+
+// Superview array of a view, built as the ancestor tests once did
+static NSArray *LegacySuperviews(VIEW_CLASS *view)
+{
+    NSMutableArray *array = [NSMutableArray array];
+    for (VIEW_CLASS *superview = view.superview; superview != nil; superview = superview.superview)
+        [array addObject:superview];
+    return array;
+}
+
+// The nearest common ancestor search before the leveled walk, kept as a baseline
+static VIEW_CLASS *LegacyNearestCommonAncestor(VIEW_CLASS *view, VIEW_CLASS *aView)
+{
+    if (view == aView)
+        return view;
+    
+    // Direct superview relationships
+    if ([LegacySuperviews(aView) containsObject:view])
+        return view;
+    if ([LegacySuperviews(view) containsObject:aView])
+        return aView;
+    
+    // Indirect common ancestor
+    NSArray *ancestors = LegacySuperviews(view);
+    for (VIEW_CLASS *ancestor in LegacySuperviews(aView))
+        if ([ancestors containsObject:ancestor])
+            return ancestor;
+    
+    return nil;
+}
+
+// Make half the constraints look IB-generated so classification has work to do
+static void MarkAsArchived(NSArray *constraints)
+{
+    BOOL hasIdentifiers = [NSLayoutConstraint instancesRespondToSelector:@selector(identifier)];
+    [constraints enumerateObjectsUsingBlock:^(NSLayoutConstraint *constraint, NSUInteger idx, BOOL *stop) {
+        if (constraint.shouldBeArchived) return;
+        constraint.shouldBeArchived = YES;
+        if (hasIdentifiers && (idx % 2))
+            constraint.identifier = @"IB auto generated at build time for view with fixed frame";
+    }];
+}
+
+static BenchmarkCaseBlock BlockForBenchmarkCase(NSString *name)
+{
+    if ([name isEqualToString:@"InstallConstraints"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            return BenchmarkTime(^{
+                InstallConstraints(fixture.constraints, 0, BENCHMARK_NAMETAG);
+            });
+        };
+    
+    // The same pairs as nearestCommonAncestorToView, run on every
+    // shape, deep chains and wide fans included
+    if ([name isEqualToString:@"nearestCommonAncestorToViewLegacy"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            NSArray *views = fixture.views;
+            NSUInteger count = views.count;
+            return BenchmarkTime(^{
+                for (NSUInteger i = 0; i < 1000; i++)
+                    LegacyNearestCommonAncestor(views[i % count], views[count - 1 - (i % count)]);
+            });
+        };
+    
+    if ([name isEqualToString:@"nearestCommonAncestorToView"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            NSArray *views = fixture.views;
+            NSUInteger count = views.count;
+            return BenchmarkTime(^{
+                for (NSUInteger i = 0; i < 1000; i++)
+                    [views[i % count] nearestCommonAncestorToView:views[count - 1 - (i % count)]];
+            });
+        };
+    
+    if ([name isEqualToString:@"constraintsNamed"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            VIEW_CLASS *view = fixture.deepestView;
+            return BenchmarkTime(^{
+                [view constraintsNamed:BENCHMARK_NAMETAG];
+            });
+        };
+    
+    // A thousand repeat lookups in an unchanged tree, after one warming call
+    if ([name isEqualToString:@"cachedConstraintNamed"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            VIEW_CLASS *view = fixture.deepestView;
+            [view cachedConstraintNamed:BENCHMARK_NAMETAG];
+            return BenchmarkTime(^{
+                for (NSUInteger i = 0; i < 1000; i++)
+                    [view cachedConstraintNamed:BENCHMARK_NAMETAG];
+            });
+        };
+    
+    // The same lookup narrowed by view and priority, compiled once
+    if ([name isEqualToString:@"ConstraintQuery"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            VIEW_CLASS *view = fixture.deepestView;
+            ConstraintQuery *query = [ConstraintQuery queryWithString:@"name == \"" BENCHMARK_NAMETAG "\" && view == $v && priority <= 1000"];
+            NSDictionary *bindings = @{@"v" : view};
+            return BenchmarkTime(^{
+                [query matchesFromView:view bindings:bindings];
+            });
+        };
+    
+    if ([name isEqualToString:@"constraintsMatchingConstraints"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            // Equal but distinct copies of the deepest constraints
+            NSArray *source = fixture.constraints;
+            NSRange range = NSMakeRange(source.count - MIN(source.count, 100), MIN(source.count, 100));
+            NSMutableArray *copies = [NSMutableArray array];
+            for (NSLayoutConstraint *c in [source subarrayWithRange:range])
+                [copies addObject:[NSLayoutConstraint constraintWithItem:c.firstItem attribute:c.firstAttribute relatedBy:c.relation toItem:c.secondItem attribute:c.secondAttribute multiplier:c.multiplier constant:c.constant]];
+            VIEW_CLASS *view = fixture.deepestView;
+            return BenchmarkTime(^{
+                [view constraintsMatchingConstraints:copies];
+            });
+        };
+    
+    // What links each constrained pair, asked from the first item
+    if ([name isEqualToString:@"constraintsReferencingViewAndView"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            NSMutableArray *pairs = [NSMutableArray array];
+            for (NSLayoutConstraint *c in fixture.constraints)
+                if (c.secondItem && (pairs.count < 1000))
+                    [pairs addObject:c];
+            return BenchmarkTime(^{
+                for (NSLayoutConstraint *c in pairs)
+                    [c.firstItem constraintsReferencingView:c.firstItem andView:c.secondItem];
+            });
+        };
+    
+    if ([name isEqualToString:@"allSubviews"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            return BenchmarkTime(^{
+                [fixture.root allSubviews];
+            });
+        };
+    
+    if ([name isEqualToString:@"autoAddConstraintNames"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            for (NSLayoutConstraint *constraint in fixture.constraints)
+                constraint.nametag = nil;
+            double elapsed = BenchmarkTime(^{
+                [NSLayoutConstraint autoAddConstraintNames:fixture.constraints];
+            });
+            for (NSLayoutConstraint *constraint in fixture.constraints)
+                constraint.nametag = BENCHMARK_NAMETAG;
+            return elapsed;
+        };
+    
+    if ([name isEqualToString:@"viewTree"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            return BenchmarkTime(^{
+                [fixture.root viewTree];
+            });
+        };
+    
+    if ([name isEqualToString:@"sourceTypeLegacy"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            MarkAsArchived(fixture.constraints);
+            return BenchmarkTime(^{
+                for (NSLayoutConstraint *constraint in fixture.constraints)
+                    LegacySourceType(constraint);
+            });
+        };
+    
+    if ([name isEqualToString:@"sourceType"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            MarkAsArchived(fixture.constraints);
+            return BenchmarkTime(^{
+                for (NSLayoutConstraint *constraint in fixture.constraints)
+                    [constraint sourceType];
+            });
+        };
+    
+    if ([name isEqualToString:@"stringValueReport"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            MarkAsArchived(fixture.constraints);
+            return BenchmarkTime(^{
+                for (NSLayoutConstraint *constraint in fixture.constraints)
+                    [constraint stringValue];
+            });
+        };
+    
+    // 1000 calls each, deepest view against the root and back, so
+    // both a hit and a full-length miss are in every sample
+    if ([name isEqualToString:@"isAncestorOfViewLegacy"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            VIEW_CLASS *root = fixture.root;
+            VIEW_CLASS *deepest = fixture.deepestView;
+            return BenchmarkTime(^{
+                for (NSUInteger i = 0; i < 500; i++)
+                {
+                    [deepest.superviews containsObject:root];
+                    [root.superviews containsObject:deepest];
+                }
+            });
+        };
+    
+    if ([name isEqualToString:@"isAncestorOfView"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            VIEW_CLASS *root = fixture.root;
+            VIEW_CLASS *deepest = fixture.deepestView;
+            return BenchmarkTime(^{
+                for (NSUInteger i = 0; i < 500; i++)
+                {
+                    [root isAncestorOfView:deepest];
+                    [deepest isAncestorOfView:root];
+                }
+            });
+        };
+    
+    if ([name isEqualToString:@"depthInHierarchy"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            VIEW_CLASS *deepest = fixture.deepestView;
+            return BenchmarkTime(^{
+                for (NSUInteger i = 0; i < 1000; i++)
+                    [deepest depthInHierarchy];
+            });
+        };
+    
+    // Teardown as callers did it before, view by view
+    if ([name isEqualToString:@"teardownPerView"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            InstallConstraints(fixture.constraints, 0, BENCHMARK_NAMETAG);
+            return BenchmarkTime(^{
+                for (VIEW_CLASS *view in fixture.views)
+                    for (NSLayoutConstraint *constraint in view.referencingConstraints)
+                        [constraint remove];
+            });
+        };
+    
+    if ([name isEqualToString:@"removeConstraintsReferencingSubtree"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            InstallConstraints(fixture.constraints, 0, BENCHMARK_NAMETAG);
+            return BenchmarkTime(^{
+                [fixture.root removeConstraintsReferencingSubtree];
+            });
+        };
+    
+    // Named teardown as it was: look up from each view, then
+    // remove one constraint at a time
+    if ([name isEqualToString:@"removeConstraintsNamedLegacy"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            InstallConstraints(fixture.constraints, 0, BENCHMARK_NAMETAG);
+            return BenchmarkTime(^{
+                for (VIEW_CLASS *view in fixture.views)
+                    for (NSLayoutConstraint *constraint in [view constraintsNamed:BENCHMARK_NAMETAG])
+                        [constraint remove];
+            });
+        };
+    
+    if ([name isEqualToString:@"removeSubtreeConstraintsNamed"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            InstallConstraints(fixture.constraints, 0, BENCHMARK_NAMETAG);
+            return BenchmarkTime(^{
+                [fixture.root removeSubtreeConstraintsNamed:BENCHMARK_NAMETAG];
+            });
+        };
+    
+    // Three attribute tests per constraint, as visualFormat makes
+    if ([name isEqualToString:@"attributeTestsLegacy"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            __block NSUInteger hits = 0;
+            return BenchmarkTime(^{
+                for (NSLayoutConstraint *constraint in fixture.constraints)
+                {
+                    NSLayoutAttribute attribute = constraint.firstAttribute;
+                    hits += LEGACY_IS_HORIZONTAL_ATTRIBUTE(attribute);
+                    hits += LEGACY_IS_SIZE_ATTRIBUTE(attribute);
+                    hits += LEGACY_IS_CENTER_ATTRIBUTE(attribute);
+                }
+            });
+        };
+    
+    if ([name isEqualToString:@"attributeTests"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            __block NSUInteger hits = 0;
+            return BenchmarkTime(^{
+                for (NSLayoutConstraint *constraint in fixture.constraints)
+                {
+                    NSLayoutAttribute attribute = constraint.firstAttribute;
+                    hits += IS_HORIZONTAL_ATTRIBUTE(attribute);
+                    hits += IS_SIZE_ATTRIBUTE(attribute);
+                    hits += IS_CENTER_ATTRIBUTE(attribute);
+                }
+            });
+        };
+    
+    // Regenerated constraints with every tenth constant moved
+    if ([name isEqualToString:@"PlanConstraintsInSubtree"])
+        return ^double(ConstraintBenchmarkFixture *fixture) {
+            NSMutableArray *desired = [NSMutableArray array];
+            NSUInteger i = 0;
+            for (NSLayoutConstraint *c in fixture.constraints)
+            {
+                CGFloat constant = c.constant + ((i++ % 10) ? 0 : 1);
+                [desired addObject:[NSLayoutConstraint constraintWithItem:c.firstItem attribute:c.firstAttribute relatedBy:c.relation toItem:c.secondItem attribute:c.secondAttribute multiplier:c.multiplier constant:constant]];
+            }
+            return BenchmarkTime(^{
+                PlanConstraintsInSubtree(desired, fixture.root);
+            });
+        };
+    
+    return nil;
+}
+
+#pragma mark - Running
+
+static NSString *BenchmarkJSON(NSDictionary *report)
+{
+    NSError *error;
+    NSData *data = [NSJSONSerialization dataWithJSONObject:report options:NSJSONWritingPrettyPrinted error:&error];
+    if (!data)
+    {
+        NSLog(@"Error: Could not serialize benchmark results. %@", error.localizedFailureReason);
+        return nil;
+    }
+    return [[NSString alloc] initWithData:data encoding:NSUTF8StringEncoding];
+}
+
+static NSDictionary *RunBenchmarkCase(BenchmarkCaseInfo info, BenchmarkTreeShape shape, NSUInteger viewCount, NSUInteger iterations, ConstraintBenchmarkFixture *shared)
+{
+    NSMutableDictionary *result = [@{
+        @"case" : info.name,
+        @"shape" : NameForBenchmarkShape(shape),
+        @"views" : @(viewCount),
+        @"iterations" : @(iterations),
+    } mutableCopy];
+    
+    BOOL deepChain = (shape == BenchmarkShapeDeepChain);
+    if (deepChain && info.deepChainLimit && (viewCount > info.deepChainLimit))
+    {
+        result[@"skipped"] = @YES;
+        return result;
+    }
+    
+    BenchmarkCaseBlock block = BlockForBenchmarkCase(info.name);
+    NSMutableArray *samples = [NSMutableArray array];
+    NSUInteger constraintCount = shared.constraints.count;
+    for (NSUInteger i = 0; i < MAX(iterations, 1); i++)
+    {
+        @autoreleasepool
+        {
+            ConstraintBenchmarkFixture *fixture = info.needsFreshTree ?
+                [ConstraintBenchmarkFixture fixtureWithShape:shape viewCount:viewCount install:NO] :
+                shared;
+            constraintCount = fixture.constraints.count;
+            [samples addObject:@(block(fixture))];
+        }
+    }
+    
+    [samples sortUsingSelector:@selector(compare:)];
+    result[@"constraints"] = @(constraintCount);
+    result[@"median_us"] = samples[samples.count / 2];
+    result[@"min_us"] = samples.firstObject;
+    result[@"max_us"] = samples.lastObject;
+    return result;
+}
+
+NSString *RunConstraintPackBenchmarks(NSArray *viewCounts, NSUInteger iterations)
+{
+    NSMutableArray *results = [NSMutableArray array];
+    NSUInteger caseCount = sizeof(BenchmarkCases) / sizeof(BenchmarkCases[0]);
+    
+    for (NSNumber *viewCount in viewCounts)
+    {
+        for (BenchmarkTreeShape shape = 0; shape < BenchmarkShapeCount; shape++)
+        {
+            @autoreleasepool
+            {
+                ConstraintBenchmarkFixture *shared = [ConstraintBenchmarkFixture fixtureWithShape:shape viewCount:viewCount.unsignedIntegerValue install:YES];
+                for (NSUInteger i = 0; i < caseCount; i++)
+                    [results addObject:RunBenchmarkCase(BenchmarkCases[i], shape, viewCount.unsignedIntegerValue, iterations, shared)];
+            }
+        }
+    }
+    
+    NSDictionary *report = @{
+        @"suite" : @"ConstraintPack",
+        @"date" : [NSDate date].description,
+#if TARGET_OS_IPHONE
+        @"platform" : [UIDevice currentDevice].model,
+#elif TARGET_OS_MAC
+        @"platform" : @"OS X",
+#endif
+        @"results" : results,
+    };
+    return BenchmarkJSON(report);
+}
+
+#pragma mark - Nametag Memory
+
+// Heap footprint of an object, 0 for tagged pointers and constants
+static NSUInteger HeapBytes(id object)
+{
+    const void *pointer = (__bridge const void *) object;
+    if (!malloc_zone_from_ptr(pointer)) return 0;
+    return malloc_size(pointer);
+}
+
+NSString *NametagMemoryReport(NSUInteger constraintCount)
+{
+    NSArray *phrases = @[@"View Position", @"Constrain to Superview", @"Constrain Size",
+                         @"Center Horizontal", @"Center Vertical", @"Hug Horizontal",
+                         @"Hug Vertical", @"Resist Horizontal", @"Resist Vertical",
+                         @"Minimum Size", @"Maximum Size", @"Aspect Ratio"];
+    VIEW_CLASS *view = [[VIEW_CLASS alloc] init];
+    
+    NSUInteger atomsBefore = NametagAtomCount();
+    NSUInteger tableBytesBefore = NametagAtomTableBytes();
+    NSUInteger uninternedBytes = 0;
+    NSMutableArray *constraints = [NSMutableArray arrayWithCapacity:constraintCount];
+    for (NSUInteger i = 0; i < constraintCount; i++)
+    {
+        // Build each tag fresh, as names composed at runtime are.
+        // Without interning, every constraint would keep its own
+        NSString *tag = [NSString stringWithFormat:@"%@ %d", phrases[i % phrases.count], (int) (i % 10)];
+        uninternedBytes += HeapBytes(tag);
+        
+        NSLayoutConstraint *constraint = [NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeWidth relatedBy:NSLayoutRelationEqual toItem:nil attribute:NSLayoutAttributeNotAnAttribute multiplier:1 constant:i];
+        constraint.nametag = tag;
+        [constraints addObject:constraint];
+    }
+    
+    // What the constraints actually hold
+    NSHashTable *held = [NSHashTable hashTableWithOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality];
+    for (NSLayoutConstraint *constraint in constraints)
+        [held addObject:constraint.nametag];
+    NSUInteger internedBytes = 0;
+    for (NSString *tag in held)
+        internedBytes += HeapBytes(tag);
+    
+    NSUInteger tableBytes = NametagAtomTableBytes() - tableBytesBefore;
+    NSDictionary *report = @{
+        @"suite" : @"NametagMemory",
+        @"date" : [NSDate date].description,
+        @"constraints" : @(constraintCount),
+        @"distinct_nametags" : @(held.count),
+        @"new_atoms" : @(NametagAtomCount() - atomsBefore),
+        @"uninterned_bytes" : @(uninternedBytes),
+        @"interned_bytes" : @(internedBytes),
+        @"atom_table_bytes" : @(tableBytes),
+        @"bytes_saved" : @((long long) uninternedBytes - (long long) internedBytes - (long long) tableBytes),
+    };
+    return BenchmarkJSON(report);
+}
+
+#pragma mark - Visual Format Rows
+
+// Five formats per row: stack under the previous row, stretch,
+// fix the height, and fill the row with its label
+static NSUInteger LayOutBenchmarkRows(NSArray *rows, NSArray *(^generate)(NSString *format, NSDictionary *metrics, NSDictionary *bindings))
+{
+    NSDictionary *metrics = @{@"indent" : @(AQUA_INDENT), @"height" : @(44), @"spacing" : @(1)};
+    NSUInteger count = 0;
+    VIEW_CLASS *previous = nil;
+    for (VIEW_CLASS *row in rows)
+    {
+        VIEW_CLASS *label = row.subviews.firstObject;
+        NSDictionary *rowBindings = NSDictionaryOfVariableBindings(row);
+        NSDictionary *labelBindings = NSDictionaryOfVariableBindings(label);
+        if (previous)
+            count += generate(@"V:[previous]-spacing-[row]", metrics, NSDictionaryOfVariableBindings(previous, row)).count;
+        count += generate(@"H:|-indent-[row]-indent-|", metrics, rowBindings).count;
+        count += generate(@"V:[row(==height)]", metrics, rowBindings).count;
+        count += generate(@"H:|-[label]-|", nil, labelBindings).count;
+        count += generate(@"V:|[label]|", nil, labelBindings).count;
+        previous = row;
+    }
+    return count;
+}
+
+NSString *VisualFormatRowReport(NSUInteger rowCount)
+{
+    VIEW_CLASS *container = BenchmarkView(nil);
+    NSMutableArray *rows = [NSMutableArray arrayWithCapacity:rowCount];
+    for (NSUInteger i = 0; i < rowCount; i++)
+    {
+        VIEW_CLASS *row = BenchmarkView(container);
+        BenchmarkView(row);
+        [rows addObject:row];
+    }
+    
+    __block NSUInteger constraintCount = 0;
+    double legacy = BenchmarkTime(^{
+        constraintCount = LayOutBenchmarkRows(rows, ^NSArray *(NSString *format, NSDictionary *metrics, NSDictionary *bindings) {
+            return [NSLayoutConstraint constraintsWithVisualFormat:format options:0 metrics:metrics views:bindings];
+        });
+    });
+    
+    // Cold includes compiling each template once
+    NSArray *(^templated)(NSString *, NSDictionary *, NSDictionary *) = ^NSArray *(NSString *format, NSDictionary *metrics, NSDictionary *bindings) {
+        return TemplateConstraints(format, 0, metrics, bindings);
+    };
+    ClearVisualTemplateCache();
+    double cold = BenchmarkTime(^{
+        LayOutBenchmarkRows(rows, templated);
+    });
+    double warm = BenchmarkTime(^{
+        LayOutBenchmarkRows(rows, templated);
+    });
+    
+    NSDictionary *report = @{
+        @"suite" : @"VisualFormatRows",
+        @"date" : [NSDate date].description,
+        @"rows" : @(rowCount),
+        @"constraints" : @(constraintCount),
+        @"system_parser_us" : @(legacy),
+        @"templates_cold_us" : @(cold),
+        @"templates_warm_us" : @(warm),
+        @"system_parser_rows_per_second" : @(legacy > 0 ? rowCount / (legacy / 1.0e6) : 0),
+        @"templates_rows_per_second" : @(warm > 0 ? rowCount / (warm / 1.0e6) : 0),
+        @"cached_templates" : @(VisualTemplateCacheCount()),
+    };
+    return BenchmarkJSON(report);
+}
+
+#pragma mark - Visual Format Dialect
+
+static BOOL BenchmarkClose(CGFloat a, CGFloat b)
+{
+    return fabs(a - b) <= 1.0e-5 * MAX(1, fabs(a));
+}
+
+// Same relation, allowing for formats that restate a == b + c
+// as b == a - c, and for the six digits %g writes
+static BOOL ReplayMatches(NSLayoutConstraint *original, NSLayoutConstraint *replay)
+{
+    if (original.priority != replay.priority) return NO;
+    if (!BenchmarkClose(original.multiplier, replay.multiplier)) return NO;
+    
+    // As written
+    if ((original.firstItem == replay.firstItem) && (original.secondItem == replay.secondItem) &&
+        (original.firstAttribute == replay.firstAttribute) && (original.secondAttribute == replay.secondAttribute))
+        return (original.relation == replay.relation) && BenchmarkClose(original.constant, replay.constant);
+    
+    // Restated, which only works without a multiplier
+    if ((original.multiplier != 1) || !replay.secondItem) return NO;
+    if ((original.firstItem == replay.secondItem) && (original.secondItem == replay.firstItem) &&
+        (original.firstAttribute == replay.secondAttribute) && (original.secondAttribute == replay.firstAttribute))
+        return (original.relation == -replay.relation) && BenchmarkClose(original.constant, -replay.constant);
+    return NO;
+}
+
+// The tree's constraints plus one dialect extension per view:
+// trailing insets either way round, scaled sizes, centers and LTR
+static NSArray *DialectConstraintsForTree(VIEW_CLASS *root)
+{
+    NSMutableArray *constraints = [BenchmarkConstraintsForTree(root) mutableCopy];
+    NSUInteger i = 0;
+    for (VIEW_CLASS *view in root.allSubviews)
+    {
+        VIEW_CLASS *parent = view.superview;
+        NSUInteger index = [parent.subviews indexOfObjectIdenticalTo:view];
+        NSLayoutConstraint *constraint;
+        switch (i++ % 5)
+        {
+            case 0:
+                constraint = [NSLayoutConstraint constraintWithItem:parent attribute:NSLayoutAttributeTrailing relatedBy:NSLayoutRelationGreaterThanOrEqual toItem:view attribute:NSLayoutAttributeTrailing multiplier:1 constant:5];
+                constraint.priority = 750;
+                break;
+            case 1:
+                constraint = [NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeBottom relatedBy:NSLayoutRelationLessThanOrEqual toItem:parent attribute:NSLayoutAttributeBottom multiplier:1 constant:-12];
+                break;
+            case 2:
+                if (!index) continue;
+                constraint = [NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeWidth relatedBy:NSLayoutRelationEqual toItem:parent.subviews[index - 1] attribute:NSLayoutAttributeWidth multiplier:0.5 constant:-2.5];
+                break;
+            case 3:
+                constraint = [NSLayoutConstraint constraintWithItem:parent attribute:NSLayoutAttributeCenterY relatedBy:NSLayoutRelationEqual toItem:view attribute:NSLayoutAttributeCenterY multiplier:1 constant:0];
+                break;
+            default:
+                constraint = [NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeLeft relatedBy:NSLayoutRelationGreaterThanOrEqual toItem:parent attribute:NSLayoutAttributeLeft multiplier:1 constant:3];
+                break;
+        }
+        [constraints addObject:constraint];
+    }
+    return constraints;
+}
+
+NSString *VisualFormatDialectReport(NSUInteger viewCount, NSUInteger parses)
+{
+    VIEW_CLASS *root = BuildBenchmarkTree(BenchmarkShapeGrid, viewCount);
+    NSArray *constraints = DialectConstraintsForTree(root);
+    NSMutableDictionary *bindings = [NSMutableDictionary dictionary];
+    for (VIEW_CLASS *view in [@[root] arrayByAddingObjectsFromArray:root.allSubviews])
+        bindings[view.objectName] = view;
+    
+    // Round trip each constraint: visualFormat, parse, compare
+    NSMutableArray *formats = [NSMutableArray arrayWithCapacity:constraints.count];
+    NSMutableArray *mismatches = [NSMutableArray array];
+    NSUInteger matched = 0;
+    for (NSLayoutConstraint *constraint in constraints)
+    {
+        NSString *format = constraint.visualFormat;
+        if (!format) continue;
+        [formats addObject:format];
+        
+        NSArray *replay = ConstraintsFromVisualFormatDialect(format, bindings);
+        if ((replay.count == 1) && ReplayMatches(constraint, replay.firstObject))
+            matched++;
+        else if (mismatches.count < 10)
+            [mismatches addObject:format];
+    }
+    
+    // Parse the whole dump, C only, then replay it into constraints
+    NSString *dump = [formats componentsJoinedByString:@"\n"];
+    NSData *data = [dump dataUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger iterations = MAX(parses, 1);
+    __block size_t specCount = 0;
+    double parse = BenchmarkTime(^{
+        for (NSUInteger i = 0; i < iterations; i++)
+        {
+            VFLParseResult result;
+            VFLParse(data.bytes, data.length, &result);
+            specCount = result.specCount;
+            VFLParseResultRelease(&result);
+        }
+    }) / iterations;
+    double replay = BenchmarkTime(^{
+        ConstraintsFromVisualFormatDialect(dump, bindings);
+    });
+    
+    NSDictionary *report = @{
+        @"suite" : @"VisualFormatDialect",
+        @"date" : [NSDate date].description,
+        @"views" : @(bindings.count),
+        @"constraints" : @(constraints.count),
+        @"formatted" : @(formats.count),
+        @"unformatted" : @(constraints.count - formats.count),
+        @"round_trip_matched" : @(matched),
+        @"round_trip_mismatched" : @(formats.count - matched),
+        @"mismatch_samples" : mismatches,
+        @"dump_bytes" : @(data.length),
+        @"specs_per_parse" : @(specCount),
+        @"parse_us" : @(parse),
+        @"parse_megabytes_per_second" : @(parse > 0 ? data.length / parse : 0),
+        @"parse_specs_per_second" : @(parse > 0 ? specCount / (parse / 1.0e6) : 0),
+        @"replay_us" : @(replay),
+    };
+    return BenchmarkJSON(report);
+}
+
+#pragma mark - Layout Lines
+
+// The per-pair formats BuildLineWithSpacing used to parse, kept as a baseline
+static void LegacyBuildLine(NSArray *views, NSString *spacing, NSUInteger priority)
+{
+    NSString *format = [NSString stringWithFormat:@"H:[view1]%@[view2]", spacing];
+    for (int i = 1; i < views.count; i++)
+    {
+        VIEW_CLASS *view1 = views[i - 1];
+        VIEW_CLASS *view2 = views[i];
+        NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:format options:0 metrics:nil views:NSDictionaryOfVariableBindings(view1, view2)];
+        InstallConstraints(constraints, priority, @"Build Line");
+    }
+}
+
+// Likewise MatchSizesH, one parse and install per view
+static void LegacyMatchSizesH(NSArray *views, NSUInteger priority)
+{
+    VIEW_CLASS *view1 = views[0];
+    for (int i = 1; i < views.count; i++)
+    {
+        VIEW_CLASS *view2 = views[i];
+        NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:@"H:[view1(==view2)]" options:0 metrics:nil views:NSDictionaryOfVariableBindings(view1, view2)];
+        InstallConstraints(constraints, priority, @"Match Horizontal Size");
+    }
+}
+
+// And PseudoDistributeWithSpacers, with four bindings per pair
+static void LegacyPseudoDistribute(VIEW_CLASS *superview, NSArray *views, NSLayoutFormatOptions alignment, NSUInteger priority)
+{
+    NSMutableArray *spacers = [NSMutableArray array];
+    for (int i = 0; i < views.count; i++)
+    {
+        [spacers addObject:[[VIEW_CLASS alloc] init]];
+        [spacers[i] setTranslatesAutoresizingMaskIntoConstraints:NO];
+        [superview addSubview:spacers[i]];
+    }
+    
+    VIEW_CLASS *firstspacer = spacers[0];
+    for (int i = 1; i < views.count; i++)
+    {
+        VIEW_CLASS *view1 = views[i - 1];
+        VIEW_CLASS *view2 = views[i];
+        VIEW_CLASS *spacer = spacers[i - 1];
+        NSDictionary *bindings = NSDictionaryOfVariableBindings(view1, view2, spacer, firstspacer);
+        NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:@"H:[view1][spacer(==firstspacer)][view2]" options:alignment metrics:nil views:bindings];
+        InstallConstraints(constraints, priority, @"PseudoDistribution");
+    }
+}
+
+// A fresh row of viewCount views in one container
+static NSArray *BenchmarkRow(NSUInteger viewCount)
+{
+    VIEW_CLASS *container = BenchmarkView(nil);
+    for (NSUInteger i = 0; i < viewCount; i++)
+        BenchmarkView(container);
+    return container.subviews;
+}
+
+static NSUInteger InstalledConstraintCount(NSArray *row)
+{
+    return [row.firstObject superview].constraints.count;
+}
+
+NSString *LayoutLineReport(NSArray *viewCounts)
+{
+    NSMutableArray *results = [NSMutableArray array];
+    for (NSNumber *viewCount in viewCounts)
+    {
+        NSUInteger count = viewCount.unsignedIntegerValue;
+        if (count < 2) continue;
+        
+        NSDictionary *(^measure)(NSString *, void (^)(NSArray *), void (^)(NSArray *)) = ^NSDictionary *(NSString *name, void (^legacy)(NSArray *), void (^direct)(NSArray *)) {
+            NSArray *legacyRow = BenchmarkRow(count);
+            double legacyTime = BenchmarkTime(^{ legacy(legacyRow); });
+            NSArray *directRow = BenchmarkRow(count);
+            double directTime = BenchmarkTime(^{ direct(directRow); });
+            return @{
+                @"case" : name,
+                @"views" : @(count),
+                @"legacy_us" : @(legacyTime),
+                @"direct_us" : @(directTime),
+                @"legacy_constraints" : @(InstalledConstraintCount(legacyRow)),
+                @"direct_constraints" : @(InstalledConstraintCount(directRow)),
+                @"speedup" : @(directTime > 0 ? legacyTime / directTime : 0),
+            };
+        };
+        
+        [results addObject:measure(@"BuildLine", ^(NSArray *row) {
+            LegacyBuildLine(row, @"-", 0);
+        }, ^(NSArray *row) {
+            BuildLine(row, NSLayoutFormatAlignAllCenterY, 0);
+        })];
+        [results addObject:measure(@"MatchSizesH", ^(NSArray *row) {
+            LegacyMatchSizesH(row, 0);
+        }, ^(NSArray *row) {
+            MatchSizesH(row, 0);
+        })];
+        [results addObject:measure(@"PseudoDistributeWithSpacers", ^(NSArray *row) {
+            LegacyPseudoDistribute([row.firstObject superview], row, NSLayoutFormatAlignAllCenterY, 0);
+        }, ^(NSArray *row) {
+            PseudoDistributeWithSpacers([row.firstObject superview], row, NSLayoutFormatAlignAllCenterY, 0);
+        })];
+    }
+    
+    NSDictionary *report = @{
+        @"suite" : @"LayoutLines",
+        @"date" : [NSDate date].description,
+        @"results" : results,
+    };
+    return BenchmarkJSON(report);
+}
+
+#pragma mark - Grids
+
+// The Grids sample: a format per three-view row, a low-priority pin
+// per label, then spacer views distributing the middle column
+static void LegacyGrid(VIEW_CLASS *container, NSArray *cells)
+{
+    NSMutableArray *switches = [NSMutableArray array];
+    for (NSUInteger i = 0; i + 2 < cells.count; i += 3)
+    {
+        VIEW_CLASS *l = cells[i];
+        VIEW_CLASS *s = cells[i + 1];
+        VIEW_CLASS *b = cells[i + 2];
+        NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:@"H:|->=20-[l]-[s]-(>=0)-[b]-|" options:NSLayoutFormatAlignAllCenterY metrics:nil views:NSDictionaryOfVariableBindings(l, s, b)];
+        [container addConstraints:constraints];
+        PinWithPriority(l, @"H:|-[view]", nil, 300);
+        [switches addObject:s];
+    }
+    
+    // The sample predates guides. Leave the caller's choice as found
+    ConstraintSpacerStyle style = CurrentConstraintSpacerStyle();
+    SetConstraintSpacerStyle(ConstraintSpacerViews);
+    PseudoDistributeWithSpacers(container, switches, NSLayoutFormatAlignAllLeading, 500);
+    SetConstraintSpacerStyle(style);
+    Pin(cells[2], @"V:|-[view]");
+    Pin(cells.lastObject, @"V:[view]-|");
+}
+
+NSString *GridReport(NSArray *cellCounts)
+{
+    NSMutableArray *results = [NSMutableArray array];
+    for (NSNumber *cellCount in cellCounts)
+    {
+        // Whole three-view rows, as in the sample
+        NSUInteger count = cellCount.unsignedIntegerValue / 3 * 3;
+        if (!count) continue;
+        
+        NSArray *legacyCells = BenchmarkRow(count);
+        VIEW_CLASS *legacyContainer = [legacyCells.firstObject superview];
+        double legacyTime = BenchmarkTime(^{
+            LegacyGrid(legacyContainer, legacyCells);
+        });
+        
+        NSArray *gridCells = BenchmarkRow(count);
+        __block NSUInteger gridConstraints = 0;
+        double gridTime = BenchmarkTime(^{
+            gridConstraints = BuildGrid(gridCells, 3, AQUA_SPACE, AQUA_SPACE, 0, 0);
+        });
+        
+        [results addObject:@{
+            @"requested_cells" : cellCount,
+            @"cells" : @(count),
+            @"sample_us" : @(legacyTime),
+            @"sample_constraints" : @(legacyContainer.constraints.count),
+            @"sample_spacer_views" : @(legacyContainer.subviews.count - count),
+            @"grid_us" : @(gridTime),
+            @"grid_constraints" : @(gridConstraints),
+            @"speedup" : @(gridTime > 0 ? legacyTime / gridTime : 0),
+        }];
+    }
+    
+    NSDictionary *report = @{
+        @"suite" : @"Grids",
+        @"date" : [NSDate date].description,
+        @"note" : @"Cell counts round down to whole three-view rows: 100 runs 99 cells, 2500 runs 2499",
+        @"results" : results,
+    };
+    return BenchmarkJSON(report);
+}
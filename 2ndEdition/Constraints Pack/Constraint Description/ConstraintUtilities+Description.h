@@ -72,6 +72,16 @@
 @property (nonatomic, readonly) NSString *visualFormat;
 @end
 
+/*
+ FORMAT REPLAY
+ Rebuild constraints from visualFormat output, one format per line.
+ Views are keyed by objectName, as the formats name them. Returns
+ uninstalled constraints, or nil on a parse or lookup error.
+ See VisualFormatDialect.h for the grammar
+ */
+
+NSArray *ConstraintsFromVisualFormatDialect(NSString *formats, NSDictionary *views);
+
 /*
  CODE DESCRIPTION
  From constraint to code. For books.
@@ -9,6 +9,9 @@
 #import "ConstraintUtilities+Layout.h"
 #import "ConstraintUtilities+Matching.h"
 #import "NSObject-Description.h"
+#import "View-Traversal.h"
+#import "ConstraintUtilities+Index.h"
+#import "VisualFormatDialect.h"
 
 #ifndef UIViewNoIntrinsicMetric
 #define UIViewNoIntrinsicMetric -1
@@ -90,8 +93,8 @@
     if (!self.firstItem)
         return nil;
     
-    // Establish firstView.firstAttribute
-    NSString *firstView = self.firstView.objectName;
+    // Establish firstView.firstAttribute. Items may be layout guides
+    NSString *firstView = [self.firstItem objectName];
     NSString *firstAttribute = [NSLayoutConstraint nameForLayoutAttribute:self.firstAttribute];
     NSString *firstString = [NSString stringWithFormat:@"<%@>.%@", firstView, firstAttribute];
     
@@ -103,7 +106,7 @@
         return [NSString stringWithFormat:@"%@ %@ %0.01f", firstString, relationString, self.constant];
     
     // Establish secondView.secondAttribute
-    NSString *secondView = self.secondView.objectName;
+    NSString *secondView = [self.secondItem objectName];
     NSString *secondAttribute = [NSLayoutConstraint nameForLayoutAttribute:self.secondAttribute];
     NSString *secondString = [NSString stringWithFormat:@"<%@>.%@", secondView, secondAttribute];
     
@@ -154,16 +157,50 @@
 
 #pragma mark - Format Description
 
-#define IS_LEADING_ATTRIBUTE(_ATTRIBUTE_) [@[@(NSLayoutAttributeTop), @(NSLayoutAttributeLeading), @(NSLayoutAttributeLeft)] containsObject:@(_ATTRIBUTE_)]
-#define IS_TRAILING_ATTRIBUTE(_ATTRIBUTE_) [@[@(NSLayoutAttributeBottom), @(NSLayoutAttributeTrailing), @(NSLayoutAttributeRight)] containsObject:@(_ATTRIBUTE_)]
-#define IS_UNSUPPORTED_ATTRIBUTE(_ATTRIBUTE_) [@[@(NSLayoutAttributeLeft), @(NSLayoutAttributeRight), @(NSLayoutAttributeBaseline)] containsObject:@(_ATTRIBUTE_)]
+// Visual formats cannot express left, right or baseline
+static inline BOOL ConstraintAttributeUnsupportedInFormat(NSLayoutAttribute attribute)
+{
+    if ((attribute == NSLayoutAttributeLeft) || (attribute == NSLayoutAttributeRight))
+        return YES;
+    return ConstraintAttributeHasTrait(attribute, ConstraintTraitBaseline);
+}
+
+#define IS_LEADING_ATTRIBUTE(_ATTRIBUTE_) ConstraintAttributeHasTrait(_ATTRIBUTE_, ConstraintTraitLeading)
+#define IS_TRAILING_ATTRIBUTE(_ATTRIBUTE_) ConstraintAttributeHasTrait(_ATTRIBUTE_, ConstraintTraitTrailing)
+#define IS_UNSUPPORTED_ATTRIBUTE(_ATTRIBUTE_) ConstraintAttributeUnsupportedInFormat(_ATTRIBUTE_)
+#define IS_MARGIN_ATTRIBUTE(_ATTRIBUTE_) ConstraintAttributeHasTrait(_ATTRIBUTE_, ConstraintTraitMargin)
+
+// @priority, when not required
+static NSString *VisualFormatPriority(NSLayoutConstraint *constraint)
+{
+    if (constraint.priority >= 1000)
+        return @"";
+    return [NSString stringWithFormat:@"@%g", (double) constraint.priority];
+}
+
+// A spacing connection. Reversing restates a == b + c as
+// b == a - c for formats that read the items the other way
+static NSString *VisualFormatConnection(NSLayoutConstraint *constraint, BOOL reversed)
+{
+    NSLayoutRelation relation = constraint.relation;
+    CGFloat constant = constraint.constant;
+    if (reversed)
+    {
+        relation = (NSLayoutRelation) -relation;
+        constant = (constant == 0) ? 0 : -constant;
+    }
+    
+    NSString *relationString = (relation == NSLayoutRelationEqual) ? @"" : [NSLayoutConstraint nameForLayoutRelation:relation];
+    return [NSString stringWithFormat:@"-(%@%g%@)-", relationString, (double) constant, VisualFormatPriority(constraint)];
+}
 
 @implementation NSLayoutConstraint (FormatDescription)
 
 // Where possible, transform constraint to visual format
 - (NSString *) visualFormat
 {
-    // I've skipped priorities for these, although that's easily added
+    // Priorities appear as @p, except on the center extensions.
+    // ConstraintsFromVisualFormatDialect() reads these back
     NSString *item1 = self.firstView.objectName;
     NSString *item2 = self.secondView.objectName;    
     NSString *relation = [NSLayoutConstraint nameForLayoutRelation:self.relation];
@@ -175,6 +212,14 @@
     // Key for layout direction
     NSString *hOrV = IS_HORIZONTAL_ATTRIBUTE(self.firstAttribute) ? @"H:" : @"V:";
 
+    // Layout guides have no format
+    if (!self.firstView || (self.secondItem && !self.secondView))
+        return nil;
+    
+    // Margins have no format
+    if (IS_MARGIN_ATTRIBUTE(self.firstAttribute) || IS_MARGIN_ATTRIBUTE(self.secondAttribute))
+        return nil;
+    
     // Superview relationships
     BOOL secondViewIsSuperview = (self.firstView.superview == self.secondView);
     BOOL firstViewIsSuperview = (self.secondView.superview == self.firstView);
@@ -214,7 +259,7 @@
         // Handle unary size case
         if (self.isUnary)
         {
-            return [NSString stringWithFormat:@"%@[%@(%@%d)]", hOrV, item1, relation, (int) self.constant];
+            return [NSString stringWithFormat:@"%@[%@(%@%g%@)]", hOrV, item1, relation, (double) self.constant, VisualFormatPriority(self)];
         }
         
         // Attributes have to match for 2-items w/ visual format
@@ -228,12 +273,12 @@
         [result appendFormat:@"%@[%@(%@<%@>", hOrV, item2, relation, item1];
         
         if (self.multiplier != 1.0f)
-            [result appendFormat:@" * %0.1f", self.multiplier];
+            [result appendFormat:@" * %g", (double) self.multiplier];
         
         if (self.constant != 0.0f)
-            [result appendFormat:@" %@ %0.1f", (self.constant < 0) ? @"-" : @"+", self.constant];
+            [result appendFormat:@" %@ %g", (self.constant < 0) ? @"-" : @"+", fabs((double) self.constant)];
         
-        [result appendString:@")]"];
+        [result appendFormat:@"%@)]", VisualFormatPriority(self)];
         return result;
     }
     
@@ -261,6 +306,10 @@
     if (IS_UNSUPPORTED_ATTRIBUTE(self.firstAttribute) || IS_UNSUPPORTED_ATTRIBUTE(self.secondAttribute))
         hOrV = @"LTR:";
     
+    // LTR: is all left and right. Mixing in leading or trailing has no format
+    if (IS_UNSUPPORTED_ATTRIBUTE(self.firstAttribute) != IS_UNSUPPORTED_ATTRIBUTE(self.secondAttribute))
+        return nil;
+    
     // Directions must match -- Illegal otherwise except for a few
     // oddball cases, which I'm skipping such as aspect. They aren't
     // supported by visual constraints
@@ -294,13 +343,13 @@
         
         if (IS_LEADING_ATTRIBUTE(self.firstAttribute))
         {
-            // Superview at start
-            [result appendFormat:@"|-(%@%d)-[%@]", relation, (int) self.constant, describedView];
+            // Superview at start: view.leading == superview.leading + c
+            [result appendFormat:@"|%@[%@]", VisualFormatConnection(self, firstViewIsSuperview), describedView];
         }
         else
         {
-            // Superview at end
-            [result appendFormat:@"[%@]-(%@%d)-|", describedView, relation, (int) self.constant];
+            // Superview at end: superview.trailing == view.trailing + c
+            [result appendFormat:@"[%@]%@|", describedView, VisualFormatConnection(self, secondViewIsSuperview)];
         }
         return result;
     }
@@ -310,17 +359,17 @@
     NSMutableString *result = [NSMutableString string];
     [result appendFormat:@"%@", hOrV];
     
-    // [item2]-?-[item1]
+    // [item2]-?-[item1] reads item1.leading == item2.trailing + c
     if (IS_LEADING_ATTRIBUTE(self.firstAttribute) && IS_TRAILING_ATTRIBUTE(self.secondAttribute))
     {
-        [result appendFormat:@"[%@]-(%@%d)-[%@]", item2, relation, (int) self.constant, item1];
+        [result appendFormat:@"[%@]%@[%@]", item2, VisualFormatConnection(self, NO), item1];
         return result;
     }
     
-    // H:[item1]-?-[item2]
+    // H:[item1]-?-[item2] reads item2.leading == item1.trailing + c
     else if (IS_TRAILING_ATTRIBUTE(self.firstAttribute) && IS_LEADING_ATTRIBUTE(self.secondAttribute))
     {
-        [result appendFormat:@"[%@]-(%@%d)-[%@]", item1, relation, (int) self.constant, item2];
+        [result appendFormat:@"[%@]%@[%@]", item1, VisualFormatConnection(self, YES), item2];
         return result;
     }
     
@@ -329,6 +378,61 @@
 }
 @end
 
+#pragma mark - Format Replay
+
+NSArray *ConstraintsFromVisualFormatDialect(NSString *formats, NSDictionary *views)
+{
+    NSData *data = [formats dataUsingEncoding:NSUTF8StringEncoding];
+    VFLParseResult result;
+    if (!VFLParse(data.bytes, data.length, &result))
+    {
+        NSLog(@"Error: %s at offset %d in visual format", result.error, (int) result.errorOffset);
+        VFLParseResultRelease(&result);
+        return nil;
+    }
+    
+    // Look up each distinct name once
+    __unsafe_unretained VIEW_CLASS *items[MAX(result.nameCount, 1)];
+    for (size_t i = 0; i < result.nameCount; i++)
+    {
+        NSString *name = [[NSString alloc] initWithBytes:result.names[i].start length:result.names[i].length encoding:NSUTF8StringEncoding];
+        items[i] = views[name];
+        if (!items[i])
+        {
+            NSLog(@"Error: No view named %@ in visual format bindings", name);
+            VFLParseResultRelease(&result);
+            return nil;
+        }
+    }
+    
+    NSMutableArray *constraints = [NSMutableArray arrayWithCapacity:result.specCount];
+    for (size_t i = 0; i < result.specCount; i++)
+    {
+        VFLConstraintSpec spec = result.specs[i];
+        VIEW_CLASS *first = (spec.firstItem >= 0) ? items[spec.firstItem] : nil;
+        VIEW_CLASS *second = (spec.secondItem >= 0) ? items[spec.secondItem] : nil;
+        
+        // | is the other item's superview
+        if (spec.firstItem == VFLSuperview)
+            first = second.superview;
+        if (spec.secondItem == VFLSuperview)
+            second = first.superview;
+        if (!first || ((spec.secondItem != VFLNoItem) && !second))
+        {
+            NSLog(@"Error: Visual format refers to the superview of a view without one");
+            VFLParseResultRelease(&result);
+            return nil;
+        }
+        
+        NSLayoutConstraint *constraint = [NSLayoutConstraint constraintWithItem:first attribute:(NSLayoutAttribute) spec.firstAttribute relatedBy:(NSLayoutRelation) spec.relation toItem:second attribute:(NSLayoutAttribute) spec.secondAttribute multiplier:spec.multiplier constant:spec.constant];
+        constraint.priority = spec.priority;
+        [constraints addObject:constraint];
+    }
+    
+    VFLParseResultRelease(&result);
+    return constraints;
+}
+
 #pragma mark - Code Description
 
 @implementation NSLayoutConstraint (CodeDescription)
@@ -544,7 +648,9 @@
     if (self.firstItem == self.secondItem)
         return [self describeSelfConstraint];
     
-    BOOL superviewRelationship = ([self.firstView isAncestorOfView:self.secondView] || [self.secondView isAncestorOfView:self.firstView]);
+    // Siblings are the common case. Rule them out without a walk
+    BOOL superviewRelationship = ![self.firstView isSiblingOfView:self.secondView] &&
+        ([self.firstView isAncestorOfView:self.secondView] || [self.secondView isAncestorOfView:self.firstView]);
     if (superviewRelationship)
         return [self describeSuperviewBasedConstraint];
     
@@ -582,12 +688,12 @@
 
 #pragma mark - AutoNaming
 @implementation VIEW_CLASS (AutoNaming)
-// Recursively autogenerate constraint names for each view in tree
+// Autogenerate constraint names for each view in tree
 - (void) addConstraintNames
 {
-    [NSLayoutConstraint autoAddConstraintNames:self.constraints];
-    for (VIEW_CLASS *view in self.subviews)
-        [view addConstraintNames];
+    [self enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        [NSLayoutConstraint autoAddConstraintNames:view.constraints];
+    }];
 }
 
 - (void) registerView: (NSMutableDictionary *) dict
@@ -608,29 +714,24 @@
     dict[classDesc] = number;
 }
 
-// Autogenerate nametags for each view
+// Autogenerate nametags for each unnamed view in tree
 - (void) addViewNames: (NSMutableDictionary *) dict
 {
-    if (self.nametag)
-    {
-        for (VIEW_CLASS *view in self.subviews)
-            [view addViewNames:dict];
-        return;
-    }
-    
-    NSString *classDesc = self.class.description;
-    if ([classDesc hasPrefix:@"NS"])
-        classDesc = [classDesc substringFromIndex:2];
-    if ([classDesc hasPrefix:@"UI"])
-        classDesc = [classDesc substringFromIndex:2];
-    
-    [self registerView:dict];
-    NSNumber *number = dict[classDesc];
-    NSString *viewName = [NSString stringWithFormat:@"%@%@", classDesc, number];
-    self.nametag = viewName;
-    
-    for (VIEW_CLASS *view in self.subviews)
-        [view addViewNames:dict];
+    [self enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        if (view.nametag)
+            return;
+        
+        NSString *classDesc = view.class.description;
+        if ([classDesc hasPrefix:@"NS"])
+            classDesc = [classDesc substringFromIndex:2];
+        if ([classDesc hasPrefix:@"UI"])
+            classDesc = [classDesc substringFromIndex:2];
+        
+        [view registerView:dict];
+        NSNumber *number = dict[classDesc];
+        NSString *viewName = [NSString stringWithFormat:@"%@%@", classDesc, number];
+        view.nametag = viewName;
+    }];
 }
 
 // Entry point for generating nametags
@@ -642,12 +743,11 @@
     if (self.nametag)
         [self registerView:dict];
 
-    // Add all subviews (recursively gathered)
-    for (VIEW_CLASS *view in self.allSubviews)
-    {
+    // Add all subviews
+    [self enumerateSubtreeWithOptions:ViewTraversalSkipRoot maxDepth:ViewTraversalNoDepthLimit usingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
         if (view.nametag)
             [view registerView:dict];
-    }
+    }];
     
     [self addViewNames:dict];
 }
@@ -695,15 +795,14 @@
 
 - (NSString *) superviewsDescription
 {
-    NSArray *superviews = self.superviews;
-    if (superviews.count > 2)
-        superviews = [superviews subarrayWithRange:NSMakeRange(0, 2)];
-    
     NSMutableString *ancestry = [NSMutableString string];
     [ancestry appendString:self.class.description];
-    for (VIEW_CLASS *view in superviews)
+    
+    // First two superviews only
+    VIEW_CLASS *view = self.superview;
+    for (int i = 0; (i < 2) && view; i++, view = view.superview)
         [ancestry appendFormat:@" : <%@>", view.objectName];
-    if (self.superviews.count > 2)
+    if (view)
         [ancestry appendString:@" ..."];
     
     return ancestry;
@@ -716,10 +815,10 @@
     
     for (NSLayoutConstraint *constraint in self.constraints)
     {
-        dict[constraint.firstView.objectName] = constraint.firstView;
-        if (!constraint.secondItem)
-            continue;
-        dict[constraint.secondView.objectName] = constraint.secondView;
+        if (constraint.firstView)
+            dict[constraint.firstView.objectName] = constraint.firstView;
+        if (constraint.secondView)
+            dict[constraint.secondView.objectName] = constraint.secondView;
     }
     
     return dict;
@@ -773,9 +872,9 @@
 // List constraints for this view and all subviews
 - (void) listAllConstraints
 {
-    [self listConstraints];
-    for (VIEW_CLASS *subview in self.subviews)
-        [subview listAllConstraints];
+    [self enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        [view listConstraints];
+    }];
 }
 
 // Book examples are less exhaustive
@@ -860,6 +959,15 @@
     // Constraint Count
     [description appendFormat:@"Constraints....%d\n", (int) self.constraints.count];
     
+#if BOOK_EXAMPLE == 0
+    // Per-axis breakdown of the layout constraints held here
+    [description appendFormat:@"By Axis........[H %d size, %d position] [V %d size, %d position]\n",
+     (int) IndexedConstraintCountOnAxis(self, ConstraintAxisHorizontal, ConstraintKindSize),
+     (int) IndexedConstraintCountOnAxis(self, ConstraintAxisHorizontal, ConstraintKindPosition),
+     (int) IndexedConstraintCountOnAxis(self, ConstraintAxisVertical, ConstraintKindSize),
+     (int) IndexedConstraintCountOnAxis(self, ConstraintAxisVertical, ConstraintKindPosition)];
+#endif
+    
 #if BOOK_EXAMPLE == 0
     // Referencing views
     NSDictionary *participating = [self participatingViews];
@@ -1011,17 +1119,16 @@
 
 - (void) showViewReport: (BOOL) descend
 {
-    printf("\nVIEW REPORT %s\n", self.viewLayoutDescription.UTF8String);
-    
-    if (!descend)
-        return;
-    
-    for (Class class in [self skippableClasses])
-        if ([self isKindOfClass:class])
-            return;
-    
-    for (VIEW_CLASS *view in self.subviews)
-        [view showViewReport: descend];
+    NSArray *skippableClasses = [self skippableClasses];
+    NSUInteger maxDepth = descend ? ViewTraversalNoDepthLimit : 0;
+    [self enumerateSubtreeWithOptions:ViewTraversalPreOrder maxDepth:maxDepth usingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        printf("\nVIEW REPORT %s\n", view.viewLayoutDescription.UTF8String);
+        
+        // Do not descend into system controls
+        for (Class class in skippableClasses)
+            if ([view isKindOfClass:class])
+                *skipDescendants = YES;
+    }];
 }
 
 - (void) generateViewReportForUser: (NSString *) userName addNames: (BOOL) addNames
@@ -1054,10 +1161,9 @@
 // DEBUG ONLY. Do not ship with this code
 - (void) testAmbiguity
 {
-    NSLog(@"<%@:0x%0x>: %@", self.class.description, (int)self, self.hasAmbiguousLayout ? @"Ambiguous" : @"Unambiguous");
-    
-    for (VIEW_CLASS *view in self.subviews)
-        [view testAmbiguity];
+    [self enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        NSLog(@"<%@:0x%0x>: %@", view.class.description, (int)view, view.hasAmbiguousLayout ? @"Ambiguous" : @"Unambiguous");
+    }];
 }
 
 
@@ -1241,7 +1347,7 @@ NSString *_AffineTransformDegreesString(CGAffineTransform t)
     UIGraphicsBeginImageContextWithOptions(self.bounds.size, NO, 0.0);
     [string drawInRect:CGRectInset(self.bounds, 4, 4)];
     
-    if ([self.nametag isEqualToString:@"Main View"])
+    if ([self hasNametag:@"Main View"])
         [self drawConstraintLinesOnPrimaryView];
     
     UIImage *image = UIGraphicsGetImageFromCurrentImageContext();
@@ -1266,25 +1372,24 @@ NSString *_AffineTransformDegreesString(CGAffineTransform t)
 
 - (void) deployVisualLayoutHints
 {
-    CALayer *hintLayer = self.hintLayer;
-    hintLayer.borderWidth = 1;
-    
-    for (Class class in [self skippableClasses])
-        if ([self isKindOfClass:class])
-            return;
-    
-    for (UIView *view in self.subviews)
-        [view deployVisualLayoutHints];
+    NSArray *skippableClasses = [self skippableClasses];
+    [self enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        CALayer *hintLayer = view.hintLayer;
+        hintLayer.borderWidth = 1;
+        
+        for (Class class in skippableClasses)
+            if ([view isKindOfClass:class])
+                *skipDescendants = YES;
+    }];
 }
 
 - (void) hideVisualLayoutHints
 {
-    CALayer *hintLayer = self.hintLayer;
-    [hintLayer removeFromSuperlayer];
-    [self.layer setValue:nil forKey:@"VisualLayoutHint"];
-
-    for (UIView *view in self.subviews)
-        [view hideVisualLayoutHints];
+    [self enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        CALayer *hintLayer = view.hintLayer;
+        [hintLayer removeFromSuperlayer];
+        [view.layer setValue:nil forKey:@"VisualLayoutHint"];
+    }];
 }
 
 - (void) updateVisualLayoutHints
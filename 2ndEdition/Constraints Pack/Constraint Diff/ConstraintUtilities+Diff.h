@@ -0,0 +1,56 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#if TARGET_OS_IPHONE
+@import Foundation;
+#elif TARGET_OS_MAC
+#import <Foundation/Foundation.h>
+#endif
+
+#import "ConstraintUtilities+Install.h"
+
+/*
+ CONSTRAINT PLANS
+ Compare a freshly generated set of constraints against what is
+ already installed and change only the difference. Instead of
+ tearing everything down in updateConstraints and rebuilding, plan
+ and apply:
+ 
+    NSArray *desired = VisualConstraints(...);
+    ApplyConstraintPlan(PlanConstraintsNamed(desired, @"Header", self));
+ 
+ Constraints pair up when they share items, attributes, relation and
+ multiplier. Pairs that differ only in constant or priority become
+ in-place updates. A priority change that crosses into or out of
+ required cannot be made on an installed constraint, so that pair
+ becomes a removal and an addition.
+ 
+ Scopes only consider NSLayoutConstraint instances. The subtree
+ scope leaves IB-archived constraints alone.
+ */
+
+@interface ConstraintPlan : NSObject
+@property (nonatomic, readonly) NSArray *additions; // desired, to install
+@property (nonatomic, readonly) NSArray *removals; // installed, to remove
+@property (nonatomic, readonly) NSArray *updates; // installed, to retune
+@property (nonatomic, readonly) NSArray *updateTargets; // desired values, parallel to updates
+@property (nonatomic, readonly) NSArray *unchanged; // installed, already as desired
+@property (nonatomic, readonly) NSString *nametag; // applied to additions, may be nil
+@property (nonatomic, readonly) BOOL isEmpty;
+@end
+
+// Plan against the constraints the pack installed on root and its
+// descendants, and on its superviews mentioning root or a descendant.
+// IB and system constraints are outside the scope and never removed
+ConstraintPlan *PlanConstraintsInSubtree(NSArray *desired, VIEW_CLASS *root);
+
+// Plan against constraints nametagged name on view and its superviews.
+// Additions take the nametag when the plan is applied
+ConstraintPlan *PlanConstraintsNamed(NSArray *desired, NSString *name, VIEW_CLASS *view);
+
+// Remove, update, then install in batches inside one transaction.
+// Returns the number of constraints added, removed or updated
+NSUInteger ApplyConstraintPlan(ConstraintPlan *plan);
@@ -0,0 +1,238 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#import "ConstraintUtilities+Diff.h"
+#import "ConstraintUtilities+Matching.h"
+#import "ConstraintUtilities+Index.h"
+#import "ConstraintUtilities+Instrumentation.h"
+#import "NametagUtilities.h"
+
+#pragma mark - Plans
+
+@interface ConstraintPlan ()
+@property (nonatomic, readwrite) NSString *nametag;
+@end
+
+@implementation ConstraintPlan
+- (instancetype) initWithAdditions: (NSArray *) additions removals: (NSArray *) removals updates: (NSArray *) updates targets: (NSArray *) targets unchanged: (NSArray *) unchanged
+{
+    if (!(self = [super init])) return self;
+    _additions = [additions copy];
+    _removals = [removals copy];
+    _updates = [updates copy];
+    _updateTargets = [targets copy];
+    _unchanged = [unchanged copy];
+    return self;
+}
+
+- (BOOL) isEmpty
+{
+    return !_additions.count && !_removals.count && !_updates.count;
+}
+
+- (NSString *) description
+{
+    return [NSString stringWithFormat:@"<%@: %d additions, %d removals, %d updates, %d unchanged>", self.class.description, (int) _additions.count, (int) _removals.count, (int) _updates.count, (int) _unchanged.count];
+}
+@end
+
+#pragma mark - Pairing
+
+static BOOL SameShape(NSLayoutConstraint *constraint1, NSLayoutConstraint *constraint2)
+{
+    if (constraint1.firstItem != constraint2.firstItem) return NO;
+    if (constraint1.secondItem != constraint2.secondItem) return NO;
+    if (constraint1.firstAttribute != constraint2.firstAttribute) return NO;
+    if (constraint1.secondAttribute != constraint2.secondAttribute) return NO;
+    if (constraint1.relation != constraint2.relation) return NO;
+    if (constraint1.multiplier != constraint2.multiplier) return NO;
+    return YES;
+}
+
+// Installed constraints cannot move across the required boundary
+static BOOL CanRetune(NSLayoutConstraint *installed, NSLayoutConstraint *desired)
+{
+    BOOL wasRequired = (installed.priority == LayoutPriorityRequired);
+    BOOL isRequired = (desired.priority == LayoutPriorityRequired);
+    return (wasRequired == isRequired);
+}
+
+// Take the first candidate passing the test out of its bucket
+static NSLayoutConstraint *TakeCandidate(NSDictionary *buckets, NSLayoutConstraint *desired, BOOL (^test)(NSLayoutConstraint *installed))
+{
+    NSMutableArray *bucket = buckets[@(ConstraintShapeSignatureFor(desired))];
+    for (NSUInteger i = 0; i < bucket.count; i++)
+    {
+        NSLayoutConstraint *installed = bucket[i];
+        if (!SameShape(installed, desired) || !test(installed))
+            continue;
+        
+        [bucket removeObjectAtIndex:i];
+        return installed;
+    }
+    return nil;
+}
+
+static ConstraintPlan *PlanAgainstInstalled(NSArray *desired, NSArray *installed)
+{
+    CONSTRAINT_PROBE();
+    NSMutableArray *additions = [NSMutableArray array];
+    NSMutableArray *removals = [NSMutableArray array];
+    NSMutableArray *updates = [NSMutableArray array];
+    NSMutableArray *targets = [NSMutableArray array];
+    NSMutableArray *unchanged = [NSMutableArray array];
+    
+    NSMutableDictionary *buckets = [NSMutableDictionary dictionary];
+    for (NSLayoutConstraint *constraint in installed)
+    {
+        NSNumber *key = @(ConstraintShapeSignatureFor(constraint));
+        NSMutableArray *bucket = buckets[key];
+        if (!bucket)
+        {
+            bucket = [NSMutableArray array];
+            buckets[key] = bucket;
+        }
+        [bucket addObject:constraint];
+    }
+    
+    // Exact matches first, so a retune never steals
+    // a constraint that some other desired one matches outright
+    NSMutableArray *pending = [NSMutableArray array];
+    for (NSLayoutConstraint *constraint in desired)
+    {
+        if (![constraint isKindOfClass:[NSLayoutConstraint class]])
+            continue;
+        
+        NSLayoutConstraint *match = TakeCandidate(buckets, constraint, ^BOOL(NSLayoutConstraint *candidate) {
+            return (candidate.constant == constraint.constant) && (candidate.priority == constraint.priority);
+        });
+        if (match)
+            [unchanged addObject:match];
+        else
+            [pending addObject:constraint];
+    }
+    
+    for (NSLayoutConstraint *constraint in pending)
+    {
+        NSLayoutConstraint *match = TakeCandidate(buckets, constraint, ^BOOL(NSLayoutConstraint *candidate) {
+            return CanRetune(candidate, constraint);
+        });
+        if (match)
+        {
+            [updates addObject:match];
+            [targets addObject:constraint];
+        }
+        else
+            [additions addObject:constraint];
+    }
+    
+    // Whatever nobody claimed goes
+    for (NSLayoutConstraint *constraint in installed)
+    {
+        NSArray *bucket = buckets[@(ConstraintShapeSignatureFor(constraint))];
+        if ([bucket indexOfObjectIdenticalTo:constraint] != NSNotFound)
+            [removals addObject:constraint];
+    }
+    
+    return [[ConstraintPlan alloc] initWithAdditions:additions removals:removals updates:updates targets:targets unchanged:unchanged];
+}
+
+#pragma mark - Scopes
+
+ConstraintPlan *PlanConstraintsInSubtree(NSArray *desired, VIEW_CLASS *root)
+{
+    CONSTRAINT_PROBE();
+    if (!root) return nil;
+    
+    // Held inside the subtree, plus held above it and mentioning
+    // a subtree view, as with subtree teardown. Only the pack's own
+    // installs are in scope, so IB, layout guide and encapsulated
+    // layout constraints never land in removals
+    NSMutableArray *members = [NSMutableArray array];
+    NSMutableArray *installed = [NSMutableArray array];
+    [root enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        [members addObject:view];
+        for (NSLayoutConstraint *constraint in view.constraints)
+        {
+            if (constraint.installedByPack && (constraint.indexedOwner == view))
+                [installed addObject:constraint];
+        }
+    }];
+    for (NSLayoutConstraint *constraint in IndexedConstraintsReferencingViews(members, root.superview))
+    {
+        if (constraint.installedByPack)
+            [installed addObject:constraint];
+    }
+    return PlanAgainstInstalled(desired, installed);
+}
+
+ConstraintPlan *PlanConstraintsNamed(NSArray *desired, NSString *name, VIEW_CLASS *view)
+{
+    CONSTRAINT_PROBE();
+    if (!name)
+    {
+        NSLog(@"Error: Cannot plan against an unnamed scope. Use PlanConstraintsInSubtree instead.");
+        return nil;
+    }
+    
+    NSMutableArray *installed = [NSMutableArray array];
+    for (NSLayoutConstraint *constraint in [view constraintsNamed:name])
+    {
+        if ([constraint.class isEqual:[NSLayoutConstraint class]])
+            [installed addObject:constraint];
+    }
+    
+    ConstraintPlan *plan = PlanAgainstInstalled(desired, installed);
+    plan.nametag = name;
+    return plan;
+}
+
+#pragma mark - Applying
+
+NSUInteger ApplyConstraintPlan(ConstraintPlan *plan)
+{
+    CONSTRAINT_PROBE();
+    if (!plan || plan.isEmpty) return 0;
+    
+    NSUInteger count = PerformConstraintTransaction(^{
+        RemoveConstraints(plan.removals);
+        
+        for (NSUInteger i = 0; i < plan.updates.count; i++)
+        {
+            NSLayoutConstraint *installed = plan.updates[i];
+            NSLayoutConstraint *target = plan.updateTargets[i];
+            if (installed.priority != target.priority)
+                installed.priority = target.priority;
+            if (installed.constant != target.constant)
+                installed.constant = target.constant;
+        }
+        
+        if (plan.nametag)
+        {
+            InstallConstraints(plan.additions, 0, plan.nametag);
+            return;
+        }
+        
+        // InstallConstraints assigns one nametag to its whole batch,
+        // so keep each addition's own tag by batching per tag
+        NSMapTable *batches = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+        for (NSLayoutConstraint *constraint in plan.additions)
+        {
+            id key = constraint.nametag ? constraint.nametag : [NSNull null];
+            NSMutableArray *batch = [batches objectForKey:key];
+            if (!batch)
+            {
+                batch = [NSMutableArray array];
+                [batches setObject:batch forKey:key];
+            }
+            [batch addObject:constraint];
+        }
+        for (id key in batches)
+            InstallConstraints([batches objectForKey:key], 0, (key == [NSNull null]) ? nil : key);
+    });
+    
+    return count + plan.updates.count;
+}
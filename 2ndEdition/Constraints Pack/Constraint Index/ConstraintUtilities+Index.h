@@ -0,0 +1,106 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#if TARGET_OS_IPHONE
+@import Foundation;
+#elif TARGET_OS_MAC
+#import <Foundation/Foundation.h>
+#endif
+
+#import "ConstraintUtilities+Install.h"
+
+// If you use in production code, please make sure to add
+// namespace indicators to class category methods
+
+/*
+ CONSTRAINT INDEX
+ Each view keeps a weak set of the constraints that mention it, and
+ each indexed constraint remembers the view it is installed on. Owners
+ also bucket their named constraints by nametag and by (item, nametag).
+ The pack's install and remove routines keep the index current, and
+ renaming an installed constraint moves it between buckets. A view's
+ existing constraints (IB, system, anything added before the pack
+ saw it) are folded in the first time a query passes through it.
+ 
+ Constraints added to or removed from an indexed view afterwards with
+ raw addConstraint: or removeConstraint: bypass the index. Run
+ ValidateConstraintIndex in debug builds to catch them.
+ 
+ Removing a view from its superview drops the constraints its old
+ ancestors held on it, and the index is not told. Queries skip any
+ hit that is no longer active (or, before iOS 8 and OS X 10.10, whose
+ items have left the owner's subtree), so a removed and re-added view
+ never reports constraints that went with the removal.
+ */
+
+// Install hooks, called by the pack after it adds or removes constraints
+void ConstraintIndexNoteInstalled(NSArray *constraints, VIEW_CLASS *owner);
+void ConstraintIndexNoteRemoved(NSArray *constraints, VIEW_CLASS *owner);
+
+typedef void (^ConstraintEnumerationBlock)(NSLayoutConstraint *constraint, BOOL *stop);
+
+// NSLayoutConstraint instances mentioning view that are installed on
+// ascentStart or one of its superviews, in no particular order
+NSArray *IndexedConstraintsReferencingView(VIEW_CLASS *view, VIEW_CLASS *ascentStart);
+
+// The same for several views at once, each constraint listed once
+NSArray *IndexedConstraintsReferencingViews(NSArray *views, VIEW_CLASS *ascentStart);
+
+// Constraints nametagged name installed on ascentStart or one of its
+// superviews, nearest owner first and then in the order that owner
+// holds them (or was renamed into). When view is non-nil, only those
+// mentioning it. Stops after limit matches, 0 for no limit
+NSArray *IndexedConstraintsNamed(NSString *name, VIEW_CLASS *view, VIEW_CLASS *ascentStart, NSUInteger limit);
+
+// Constraints nametagged name held by owner alone
+NSArray *IndexedConstraintsNamedOnOwner(NSString *name, VIEW_CLASS *owner);
+
+// Streaming forms of the lookups above. Set *stop to end early.
+// Do not install or remove constraints from inside the block
+void EnumerateIndexedConstraintsReferencingView(VIEW_CLASS *view, VIEW_CLASS *ascentStart, ConstraintEnumerationBlock block);
+void EnumerateIndexedConstraintsNamed(NSString *name, VIEW_CLASS *view, VIEW_CLASS *ascentStart, ConstraintEnumerationBlock block);
+
+// Owners also bucket the NSLayoutConstraints they hold by the axis
+// and kind of the first attribute. An aspect constraint, width to
+// height, lands with width
+typedef enum
+{
+    ConstraintAxisHorizontal = 0,
+    ConstraintAxisVertical = 1,
+} ConstraintAxis;
+
+typedef enum
+{
+    ConstraintKindSize = 0,
+    ConstraintKindPosition = 1,
+    ConstraintKindAny = 2,
+} ConstraintKind;
+
+// Visit one bucket without copying it. Do not install or
+// remove constraints on owner from inside the block
+void EnumerateIndexedConstraintsOnAxis(VIEW_CLASS *owner, ConstraintAxis axis, ConstraintKind kind, ConstraintEnumerationBlock block);
+NSUInteger IndexedConstraintCountOnAxis(VIEW_CLASS *owner, ConstraintAxis axis, ConstraintKind kind);
+
+// Owners also file each two-item NSLayoutConstraint under its
+// unordered item pair. Constraints between item and partner,
+// in either order, installed on ascentStart or a superview
+NSArray *IndexedConstraintsBetweenItems(id item, id partner, VIEW_CLASS *ascentStart);
+
+// Every constraint pairing item with another item, passed with
+// that partner, for building adjacency graphs. Same rules as above
+typedef void (^ConstraintPartnerBlock)(id partner, NSLayoutConstraint *constraint, BOOL *stop);
+void EnumerateIndexedPartners(id item, VIEW_CLASS *ascentStart, ConstraintPartnerBlock block);
+
+@interface NSLayoutConstraint (ConstraintIndex)
+@property (nonatomic, readonly) VIEW_CLASS *indexedOwner; // nil when not indexed
+@property (nonatomic, readonly) BOOL installedByPack; // NO for folded-in IB and system constraints
+@end
+
+#if DEBUG
+// Walk the tree, reporting unindexed and stale constraints
+NSArray *ConstraintIndexInconsistencies(VIEW_CLASS *root);
+BOOL ValidateConstraintIndex(VIEW_CLASS *root);
+#endif
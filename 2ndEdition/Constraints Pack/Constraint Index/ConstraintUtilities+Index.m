@@ -0,0 +1,631 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#import "ConstraintUtilities+Index.h"
+#import "View-Traversal.h"
+#import "View-Generation.h"
+#import "NSObject-Nametag.h"
+#import "ConstraintUtilities+Traits.h"
+
+#if TARGET_OS_IPHONE
+@import ObjectiveC;
+#elif TARGET_OS_MAC
+#import <objc/objc-runtime.h>
+#endif
+
+#pragma mark - Storage
+
+// Per-item storage. Constraints are held weakly so the
+// index never keeps a discarded constraint alive
+@interface ConstraintIndexStore : NSObject
+@property (nonatomic, readonly) NSHashTable *referencing;
+@property (nonatomic) BOOL adopted; // own constraints folded in
+@property (nonatomic) NSMapTable *named; // atom -> constraints held, in order
+@property (nonatomic) NSMapTable *namedByItem; // item -> atom -> constraints held, in order
+@property (nonatomic) NSArray *axisBuckets; // axis and kind -> constraints held
+@property (nonatomic) NSMapTable *pairs; // item -> item -> constraints held
+@end
+
+static NSHashTable *ConstraintSet(void)
+{
+    return [NSHashTable hashTableWithOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality];
+}
+
+@implementation ConstraintIndexStore
+- (instancetype) init
+{
+    if (!(self = [super init])) return self;
+    _referencing = ConstraintSet();
+    return self;
+}
+@end
+
+// Weak link from a constraint back to the view holding it
+@interface ConstraintOwnerBox : NSObject
+@property (nonatomic, weak) VIEW_CLASS *owner;
+@property (nonatomic) BOOL installedByPack; // not folded in
+@end
+
+@implementation ConstraintOwnerBox
+@end
+
+static char ConstraintIndexStoreKey;
+
+static ConstraintIndexStore *IndexStore(id item, BOOL create)
+{
+    if (!item) return nil;
+    
+    ConstraintIndexStore *store = objc_getAssociatedObject(item, &ConstraintIndexStoreKey);
+    if (!store && create)
+    {
+        store = [[ConstraintIndexStore alloc] init];
+        objc_setAssociatedObject(item, &ConstraintIndexStoreKey, store, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    return store;
+}
+
+static void RecordOwner(NSLayoutConstraint *constraint, VIEW_CLASS *owner)
+{
+    ConstraintOwnerBox *box = objc_getAssociatedObject(constraint, @selector(indexedOwner));
+    if (!box && !owner) return;
+    if (!box)
+    {
+        box = [[ConstraintOwnerBox alloc] init];
+        objc_setAssociatedObject(constraint, @selector(indexedOwner), box, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    box.owner = owner;
+    if (!owner)
+        box.installedByPack = NO;
+}
+
+#pragma mark - Names
+
+// Name buckets live on the owner, keyed by name and
+// again by (item, name) for view-filtered lookups.
+// Nametags are atoms, so buckets key by pointer
+static NSMapTable *NameBucketTable(void)
+{
+    return [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+}
+
+// Buckets keep the order constraints were named in, so the
+// first match is the first the owner holds, as with a scan of
+// its constraints. Entries are weak; released ones read as NULL
+static NSUInteger NameBucketIndex(NSPointerArray *bucket, NSLayoutConstraint *constraint)
+{
+    for (NSUInteger i = 0; i < bucket.count; i++)
+    {
+        if ([bucket pointerAtIndex:i] == (__bridge void *) constraint)
+            return i;
+    }
+    return NSNotFound;
+}
+
+static void AddToNameBucket(NSMapTable *buckets, NSString *name, NSLayoutConstraint *constraint)
+{
+    NSPointerArray *bucket = [buckets objectForKey:name];
+    if (!bucket)
+    {
+        bucket = [NSPointerArray weakObjectsPointerArray];
+        [buckets setObject:bucket forKey:name];
+    }
+    if (NameBucketIndex(bucket, constraint) == NSNotFound)
+        [bucket addPointer:(__bridge void *) constraint];
+}
+
+// Drops released entries on the way
+static void RemoveFromNameBucket(NSPointerArray *bucket, NSLayoutConstraint *constraint)
+{
+    for (NSUInteger i = bucket.count; i > 0; i--)
+    {
+        void *pointer = [bucket pointerAtIndex:i - 1];
+        if (!pointer || (pointer == (__bridge void *) constraint))
+            [bucket removePointerAtIndex:i - 1];
+    }
+}
+
+static void AddToItemNameBucket(ConstraintIndexStore *store, id item, NSString *name, NSLayoutConstraint *constraint)
+{
+    if (!item) return;
+    if (!store.namedByItem)
+        store.namedByItem = [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+    
+    NSMapTable *buckets = [store.namedByItem objectForKey:item];
+    if (!buckets)
+    {
+        buckets = NameBucketTable();
+        [store.namedByItem setObject:buckets forKey:item];
+    }
+    AddToNameBucket(buckets, name, constraint);
+}
+
+static void NameConstraint(NSLayoutConstraint *constraint, NSString *name, VIEW_CLASS *owner)
+{
+    if (!name || !owner) return;
+    
+    ConstraintIndexStore *store = IndexStore(owner, YES);
+    if (!store.named)
+        store.named = NameBucketTable();
+    AddToNameBucket(store.named, name, constraint);
+    AddToItemNameBucket(store, constraint.firstItem, name, constraint);
+    if (constraint.secondItem != constraint.firstItem)
+        AddToItemNameBucket(store, constraint.secondItem, name, constraint);
+}
+
+static void UnnameConstraint(NSLayoutConstraint *constraint, NSString *name, VIEW_CLASS *owner)
+{
+    if (!name || !owner) return;
+    
+    ConstraintIndexStore *store = IndexStore(owner, NO);
+    RemoveFromNameBucket([store.named objectForKey:name], constraint);
+    if (constraint.firstItem)
+        RemoveFromNameBucket([[store.namedByItem objectForKey:constraint.firstItem] objectForKey:name], constraint);
+    if (constraint.secondItem)
+        RemoveFromNameBucket([[store.namedByItem objectForKey:constraint.secondItem] objectForKey:name], constraint);
+}
+
+#pragma mark - Axis Buckets
+
+// Bucketed by first attribute. Only exact NSLayoutConstraint
+// instances, never content size or autoresizing constraints
+static NSInteger AxisBucketIndex(NSLayoutConstraint *constraint)
+{
+    if (![constraint.class isEqual:[NSLayoutConstraint class]])
+        return NSNotFound;
+    
+    NSUInteger traits = ConstraintAttributeTraits(constraint.firstAttribute);
+    NSInteger kind = (traits & ConstraintTraitSize) ? ConstraintKindSize : ConstraintKindPosition;
+    if (traits & ConstraintTraitHorizontal)
+        return ConstraintAxisHorizontal * 2 + kind;
+    if (traits & ConstraintTraitVertical)
+        return ConstraintAxisVertical * 2 + kind;
+    return NSNotFound;
+}
+
+static void BucketConstraint(NSLayoutConstraint *constraint, VIEW_CLASS *owner)
+{
+    NSInteger index = AxisBucketIndex(constraint);
+    if (index == NSNotFound) return;
+    
+    ConstraintIndexStore *store = IndexStore(owner, YES);
+    if (!store.axisBuckets)
+        store.axisBuckets = @[ConstraintSet(), ConstraintSet(), ConstraintSet(), ConstraintSet()];
+    [store.axisBuckets[index] addObject:constraint];
+}
+
+static void UnbucketConstraint(NSLayoutConstraint *constraint, VIEW_CLASS *owner)
+{
+    NSInteger index = AxisBucketIndex(constraint);
+    if (index == NSNotFound) return;
+    
+    NSArray *buckets = IndexStore(owner, NO).axisBuckets;
+    [buckets[index] removeObject:constraint];
+}
+
+#pragma mark - Pairs
+
+// Two-item constraints are filed on their owner under both
+// (first, second) and (second, first), so either order is
+// one probe, and each item's row lists all its partners
+static NSMapTable *ItemTable(void)
+{
+    return [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsWeakMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+}
+
+static void AddToPairBucket(NSMapTable *pairs, id item, id partner, NSLayoutConstraint *constraint)
+{
+    NSMapTable *row = [pairs objectForKey:item];
+    if (!row)
+    {
+        row = ItemTable();
+        [pairs setObject:row forKey:item];
+    }
+    
+    NSHashTable *bucket = [row objectForKey:partner];
+    if (!bucket)
+    {
+        bucket = ConstraintSet();
+        [row setObject:bucket forKey:partner];
+    }
+    [bucket addObject:constraint];
+}
+
+static void PairConstraint(NSLayoutConstraint *constraint, VIEW_CLASS *owner)
+{
+    if (![constraint.class isEqual:[NSLayoutConstraint class]]) return;
+    id first = constraint.firstItem;
+    id second = constraint.secondItem;
+    if (!first || !second) return;
+    
+    ConstraintIndexStore *store = IndexStore(owner, YES);
+    if (!store.pairs)
+        store.pairs = ItemTable();
+    AddToPairBucket(store.pairs, first, second, constraint);
+    if (first != second)
+        AddToPairBucket(store.pairs, second, first, constraint);
+}
+
+static void UnpairConstraint(NSLayoutConstraint *constraint, VIEW_CLASS *owner)
+{
+    id first = constraint.firstItem;
+    id second = constraint.secondItem;
+    if (!first || !second || !owner) return;
+    
+    NSMapTable *pairs = IndexStore(owner, NO).pairs;
+    [[[pairs objectForKey:first] objectForKey:second] removeObject:constraint];
+    [[[pairs objectForKey:second] objectForKey:first] removeObject:constraint];
+}
+
+#pragma mark - Indexing
+
+static void IndexConstraint(NSLayoutConstraint *constraint, VIEW_CLASS *owner)
+{
+    VIEW_CLASS *previous = constraint.indexedOwner;
+    if (previous == owner) return; // already indexed here
+    
+    // Moving between owners without a removal leaves old entries
+    UnnameConstraint(constraint, constraint.nametag, previous);
+    UnbucketConstraint(constraint, previous);
+    UnpairConstraint(constraint, previous);
+    
+    RecordOwner(constraint, owner);
+    NameConstraint(constraint, constraint.nametag, owner);
+    BucketConstraint(constraint, owner);
+    PairConstraint(constraint, owner);
+    [IndexStore(constraint.firstItem, YES).referencing addObject:constraint];
+    if (constraint.secondItem)
+        [IndexStore(constraint.secondItem, YES).referencing addObject:constraint];
+}
+
+// Fold in whatever the view already holds, once
+static void AdoptOwner(VIEW_CLASS *owner)
+{
+    ConstraintIndexStore *store = IndexStore(owner, YES);
+    if (store.adopted) return;
+    store.adopted = YES;
+    
+    for (NSLayoutConstraint *constraint in owner.constraints)
+        IndexConstraint(constraint, owner);
+}
+
+#pragma mark - Hooks
+
+void ConstraintIndexNoteInstalled(NSArray *constraints, VIEW_CLASS *owner)
+{
+    if (!owner) return;
+    
+    // Fold in what the owner held first, so name buckets
+    // follow the order of its constraints
+    AdoptOwner(owner);
+    for (NSLayoutConstraint *constraint in constraints)
+    {
+        IndexConstraint(constraint, owner);
+        ConstraintOwnerBox *box = objc_getAssociatedObject(constraint, @selector(indexedOwner));
+        box.installedByPack = YES;
+    }
+    if (constraints.count)
+        BumpViewGeneration(owner);
+}
+
+void ConstraintIndexNoteRemoved(NSArray *constraints, VIEW_CLASS *owner)
+{
+    if (!owner) return;
+    for (NSLayoutConstraint *constraint in constraints)
+    {
+        // Removal from a view that never held it is a no-op
+        if (constraint.indexedOwner != owner)
+            continue;
+    
+        UnnameConstraint(constraint, constraint.nametag, owner);
+        UnbucketConstraint(constraint, owner);
+        UnpairConstraint(constraint, owner);
+        RecordOwner(constraint, nil);
+        [IndexStore(constraint.firstItem, NO).referencing removeObject:constraint];
+        [IndexStore(constraint.secondItem, NO).referencing removeObject:constraint];
+    }
+    if (constraints.count)
+        BumpViewGeneration(owner);
+}
+
+#pragma mark - Queries
+
+// Removing a view makes UIKit and AppKit drop every constraint an
+// ancestor holds on the departing subtree, without telling the
+// index. Those entries linger until the pack removes or reinstalls
+// the constraint, so every query checks its hits are still live
+static BOOL ItemStillUnderOwner(id item, VIEW_CLASS *owner)
+{
+    if (!item) return YES;
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wundeclared-selector"
+    VIEW_CLASS *view = [item isKindOfClass:[VIEW_CLASS class]] ? item :
+        ([item respondsToSelector:@selector(owningView)] ? [item performSelector:@selector(owningView)] : nil);
+#pragma GCC diagnostic pop
+    for (; view != nil; view = view.superview)
+    {
+        if (view == owner)
+            return YES;
+    }
+    return NO;
+}
+
+static BOOL IndexedConstraintIsLive(NSLayoutConstraint *constraint)
+{
+    static BOOL hasActive;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        hasActive = [NSLayoutConstraint instancesRespondToSelector:@selector(isActive)];
+    });
+    if (hasActive)
+        return constraint.active;
+    
+    // Before iOS 8 and OS X 10.10, test what the removal tests
+    VIEW_CLASS *owner = constraint.indexedOwner;
+    return owner && ItemStillUnderOwner(constraint.firstItem, owner) && ItemStillUnderOwner(constraint.secondItem, owner);
+}
+
+// Every owner in the ascent must be folded in before
+// the views' sets can be trusted
+static NSHashTable *AdoptAscent(VIEW_CLASS *ascentStart)
+{
+    NSHashTable *ascent = [NSHashTable hashTableWithOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality];
+    for (VIEW_CLASS *owner = ascentStart; owner != nil; owner = owner.superview)
+    {
+        AdoptOwner(owner);
+        [ascent addObject:owner];
+    }
+    return ascent;
+}
+
+NSArray *IndexedConstraintsReferencingViews(NSArray *views, VIEW_CLASS *ascentStart)
+{
+    if (!views.count) return @[];
+    NSHashTable *ascent = AdoptAscent(ascentStart);
+    
+    // A constraint between two of the views turns up twice
+    NSHashTable *seen = (views.count > 1) ? [NSHashTable hashTableWithOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality] : nil;
+    NSMutableArray *array = [NSMutableArray array];
+    for (VIEW_CLASS *view in views)
+    {
+        for (NSLayoutConstraint *constraint in IndexStore(view, NO).referencing)
+        {
+            if (![constraint.class isEqual:[NSLayoutConstraint class]])
+                continue;
+            
+            VIEW_CLASS *owner = constraint.indexedOwner;
+            if (!owner || ![ascent containsObject:owner] || !IndexedConstraintIsLive(constraint))
+                continue;
+            
+            if (seen)
+            {
+                if ([seen containsObject:constraint]) continue;
+                [seen addObject:constraint];
+            }
+            [array addObject:constraint];
+        }
+    }
+    return array;
+}
+
+NSArray *IndexedConstraintsReferencingView(VIEW_CLASS *view, VIEW_CLASS *ascentStart)
+{
+    if (!view) return @[];
+    return IndexedConstraintsReferencingViews(@[view], ascentStart);
+}
+
+void EnumerateIndexedConstraintsReferencingView(VIEW_CLASS *view, VIEW_CLASS *ascentStart, ConstraintEnumerationBlock block)
+{
+    if (!view || !block) return;
+    NSHashTable *ascent = AdoptAscent(ascentStart);
+    
+    BOOL stop = NO;
+    for (NSLayoutConstraint *constraint in IndexStore(view, NO).referencing)
+    {
+        if (![constraint.class isEqual:[NSLayoutConstraint class]])
+            continue;
+        
+        VIEW_CLASS *owner = constraint.indexedOwner;
+        if (!owner || ![ascent containsObject:owner] || !IndexedConstraintIsLive(constraint))
+            continue;
+        
+        block(constraint, &stop);
+        if (stop) return;
+    }
+}
+
+void EnumerateIndexedConstraintsNamed(NSString *name, VIEW_CLASS *view, VIEW_CLASS *ascentStart, ConstraintEnumerationBlock block)
+{
+    if (!block) return;
+    
+    // A name never interned cannot be on any constraint
+    NSString *atom = ExistingNametagAtom(name);
+    if (!atom) return;
+    
+    BOOL stop = NO;
+    for (VIEW_CLASS *owner = ascentStart; owner != nil; owner = owner.superview)
+    {
+        AdoptOwner(owner);
+        ConstraintIndexStore *store = IndexStore(owner, NO);
+        NSMapTable *buckets = view ? [store.namedByItem objectForKey:view] : store.named;
+        NSPointerArray *bucket = [buckets objectForKey:atom];
+        for (NSLayoutConstraint *constraint in bucket)
+        {
+            if (!constraint || !IndexedConstraintIsLive(constraint)) continue;
+            block(constraint, &stop);
+            if (stop) return;
+        }
+    }
+}
+
+NSArray *IndexedConstraintsNamedOnOwner(NSString *name, VIEW_CLASS *owner)
+{
+    NSString *atom = ExistingNametagAtom(name);
+    if (!atom || !owner) return @[];
+    
+    AdoptOwner(owner);
+    NSPointerArray *bucket = [IndexStore(owner, NO).named objectForKey:atom];
+    
+    NSMutableArray *array = [NSMutableArray array];
+    for (NSLayoutConstraint *constraint in bucket)
+        if (constraint && IndexedConstraintIsLive(constraint))
+            [array addObject:constraint];
+    return array;
+}
+
+NSArray *IndexedConstraintsNamed(NSString *name, VIEW_CLASS *view, VIEW_CLASS *ascentStart, NSUInteger limit)
+{
+    NSMutableArray *array = [NSMutableArray array];
+    EnumerateIndexedConstraintsNamed(name, view, ascentStart, ^(NSLayoutConstraint *constraint, BOOL *stop) {
+        [array addObject:constraint];
+        if (array.count == limit)
+            *stop = YES;
+    });
+    return array;
+}
+
+void EnumerateIndexedConstraintsOnAxis(VIEW_CLASS *owner, ConstraintAxis axis, ConstraintKind kind, ConstraintEnumerationBlock block)
+{
+    if (!owner || !block) return;
+    AdoptOwner(owner);
+    
+    NSArray *buckets = IndexStore(owner, NO).axisBuckets;
+    if (!buckets) return;
+    
+    BOOL stop = NO;
+    for (NSInteger kindIndex = ConstraintKindSize; kindIndex <= ConstraintKindPosition; kindIndex++)
+    {
+        if ((kind != ConstraintKindAny) && (kind != kindIndex))
+            continue;
+        
+        for (NSLayoutConstraint *constraint in buckets[axis * 2 + kindIndex])
+        {
+            if (!IndexedConstraintIsLive(constraint)) continue;
+            block(constraint, &stop);
+            if (stop) return;
+        }
+    }
+}
+
+NSArray *IndexedConstraintsBetweenItems(id item, id partner, VIEW_CLASS *ascentStart)
+{
+    if (!item || !partner) return @[];
+    
+    NSMutableArray *array = [NSMutableArray array];
+    for (VIEW_CLASS *owner = ascentStart; owner != nil; owner = owner.superview)
+    {
+        AdoptOwner(owner);
+        NSHashTable *bucket = [[IndexStore(owner, NO).pairs objectForKey:item] objectForKey:partner];
+        for (NSLayoutConstraint *constraint in bucket)
+            if (IndexedConstraintIsLive(constraint))
+                [array addObject:constraint];
+    }
+    return array;
+}
+
+void EnumerateIndexedPartners(id item, VIEW_CLASS *ascentStart, ConstraintPartnerBlock block)
+{
+    if (!item || !block) return;
+    
+    BOOL stop = NO;
+    for (VIEW_CLASS *owner = ascentStart; owner != nil; owner = owner.superview)
+    {
+        AdoptOwner(owner);
+        NSMapTable *row = [IndexStore(owner, NO).pairs objectForKey:item];
+        for (id partner in row)
+        {
+            for (NSLayoutConstraint *constraint in [row objectForKey:partner])
+            {
+                if (!IndexedConstraintIsLive(constraint)) continue;
+                block(partner, constraint, &stop);
+                if (stop) return;
+            }
+        }
+    }
+}
+
+NSUInteger IndexedConstraintCountOnAxis(VIEW_CLASS *owner, ConstraintAxis axis, ConstraintKind kind)
+{
+    if (!owner) return 0;
+    AdoptOwner(owner);
+    
+    __block NSUInteger count = 0;
+    EnumerateIndexedConstraintsOnAxis(owner, axis, kind, ^(NSLayoutConstraint *constraint, BOOL *stop) {
+        count++;
+    });
+    return count;
+}
+
+@implementation NSLayoutConstraint (ConstraintIndex)
+- (VIEW_CLASS *) indexedOwner
+{
+    ConstraintOwnerBox *box = objc_getAssociatedObject(self, @selector(indexedOwner));
+    return box.owner;
+}
+
+- (BOOL) installedByPack
+{
+    ConstraintOwnerBox *box = objc_getAssociatedObject(self, @selector(indexedOwner));
+    return box.owner && box.installedByPack;
+}
+
+// Renaming an installed constraint moves it between name buckets
+- (void) setNametag: (NSString *) nametag
+{
+    VIEW_CLASS *owner = self.indexedOwner;
+    UnnameConstraint(self, self.nametag, owner);
+    [super setNametag:nametag];
+    NameConstraint(self, nametag, owner);
+    BumpViewGeneration(owner);
+}
+@end
+
+#pragma mark - Consistency
+
+#if DEBUG
+NSArray *ConstraintIndexInconsistencies(VIEW_CLASS *root)
+{
+    NSMutableArray *problems = [NSMutableArray array];
+    [root enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        ConstraintIndexStore *store = IndexStore(view, NO);
+        if (!store) return;
+    
+        // Once folded in, everything on the view must be indexed to it
+        if (store.adopted)
+        {
+            for (NSLayoutConstraint *constraint in view.constraints)
+            {
+                if (constraint.indexedOwner != view)
+                    [problems addObject:[NSString stringWithFormat:@"Unindexed constraint %@ on <%@:%p>. Added with raw addConstraint:?", constraint, view.class.description, view]];
+                else if (constraint.nametag && (NameBucketIndex([store.named objectForKey:constraint.nametag], constraint) == NSNotFound))
+                    [problems addObject:[NSString stringWithFormat:@"Constraint %@ missing from the name index on <%@:%p>", constraint, view.class.description, view]];
+            }
+        }
+    
+        // Everything indexed must still be where the index says.
+        // Report each constraint once, through its first item
+        for (NSLayoutConstraint *constraint in store.referencing)
+        {
+            if (constraint.firstItem != view)
+                continue;
+            
+            // Dead entries are skipped by every query, so only a live
+            // constraint held somewhere else is a problem
+            VIEW_CLASS *owner = constraint.indexedOwner;
+            if (owner && IndexedConstraintIsLive(constraint) && ![owner.constraints containsObject:constraint])
+                [problems addObject:[NSString stringWithFormat:@"Constraint %@ indexed to <%@:%p> is held elsewhere. Moved with raw addConstraint:?", constraint, owner.class.description, owner]];
+        }
+    }];
+    return problems;
+}
+
+BOOL ValidateConstraintIndex(VIEW_CLASS *root)
+{
+    NSArray *problems = ConstraintIndexInconsistencies(root);
+    for (NSString *problem in problems)
+        NSLog(@"Error: %@", problem);
+    return (problems.count == 0);
+}
+#endif
@@ -0,0 +1,101 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+/*
+ CONSTRAINT INDEX TESTS
+ XCTest cases for the index's view-removal handling. Add this file
+ and the pack to any iOS or OS X unit test target.
+ */
+
+@import XCTest;
+#import "ConstraintPack.h"
+
+@interface ConstraintIndexTests : XCTestCase
+@property (nonatomic) VIEW_CLASS *parent;
+@property (nonatomic) VIEW_CLASS *child;
+@property (nonatomic) NSLayoutConstraint *pin;
+@end
+
+@implementation ConstraintIndexTests
+
+// A child pinned to its parent, with the pin held by the parent
+- (void) setUp
+{
+    [super setUp];
+    self.parent = [[VIEW_CLASS alloc] initWithFrame:CGRectMake(0, 0, 200, 200)];
+    self.child = [[VIEW_CLASS alloc] initWithFrame:CGRectMake(0, 0, 20, 20)];
+    PREPCONSTRAINTS(self.child);
+    [self.parent addSubview:self.child];
+    
+    self.pin = [NSLayoutConstraint constraintWithItem:self.child attribute:NSLayoutAttributeLeft relatedBy:NSLayoutRelationEqual toItem:self.parent attribute:NSLayoutAttributeLeft multiplier:1 constant:10];
+    InstallConstraint(self.pin, 0, @"Index Test Pin");
+    XCTAssertEqual(self.pin.indexedOwner, self.parent);
+}
+
+// Removal drops the parent's pin without telling the index
+- (void) cycleChild
+{
+    [self.child removeFromSuperview];
+    [self.parent addSubview:self.child];
+    XCTAssertFalse([self.parent.constraints containsObject:self.pin]);
+}
+
+- (void) testReferencingQueriesForgetRemovedConstraints
+{
+    XCTAssertEqual(IndexedConstraintsReferencingView(self.child, self.parent).count, 1);
+    [self cycleChild];
+    
+    XCTAssertEqual(IndexedConstraintsReferencingView(self.child, self.parent).count, 0);
+    XCTAssertEqual([self.parent constraintsReferencingView:self.child].count, 0);
+    XCTAssertFalse([self.child.referencingConstraintsInSuperviews containsObject:self.pin]);
+    
+    __block NSUInteger hits = 0;
+    EnumerateIndexedConstraintsReferencingView(self.child, self.parent, ^(NSLayoutConstraint *constraint, BOOL *stop) {
+        hits++;
+    });
+    XCTAssertEqual(hits, 0);
+}
+
+- (void) testAxisBucketsForgetRemovedConstraints
+{
+    XCTAssertEqual(IndexedConstraintCountOnAxis(self.parent, ConstraintAxisHorizontal, ConstraintKindPosition), 1);
+    [self cycleChild];
+    XCTAssertEqual(IndexedConstraintCountOnAxis(self.parent, ConstraintAxisHorizontal, ConstraintKindPosition), 0);
+    XCTAssertEqual([self.parent constraintsAffectingAxis:ConstraintAxisHorizontal kind:ConstraintKindAny].count, 0);
+}
+
+- (void) testNamedLookupsForgetRemovedConstraints
+{
+    XCTAssertEqual([self.child constraintNamed:@"Index Test Pin"], self.pin);
+    [self cycleChild];
+    
+    XCTAssertNil([self.child constraintNamed:@"Index Test Pin"]);
+    XCTAssertEqual([self.child constraintsNamed:@"Index Test Pin"].count, 0);
+    XCTAssertEqual(IndexedConstraintsNamedOnOwner(@"Index Test Pin", self.parent).count, 0);
+}
+
+- (void) testPairLookupsForgetRemovedConstraints
+{
+    XCTAssertEqual([self.parent constraintsReferencingView:self.child andView:self.parent].count, 1);
+    [self cycleChild];
+    
+    XCTAssertEqual(IndexedConstraintsBetweenItems(self.child, self.parent, self.parent).count, 0);
+    XCTAssertEqual([self.parent constraintsReferencingView:self.child andView:self.parent].count, 0);
+    
+    __block NSUInteger partners = 0;
+    EnumerateIndexedPartners(self.child, self.parent, ^(id partner, NSLayoutConstraint *constraint, BOOL *stop) {
+        partners++;
+    });
+    XCTAssertEqual(partners, 0);
+}
+
+- (void) testReinstallIsFoundAgain
+{
+    [self cycleChild];
+    InstallConstraint(self.pin, 0, @"Index Test Pin");
+    XCTAssertEqual(IndexedConstraintsReferencingView(self.child, self.parent).count, 1);
+}
+@end
@@ -63,18 +63,44 @@ void InstallConstraints(NSArray *constraints, NSUInteger priority, NSString *nam
 void InstallConstraint(NSLayoutConstraint *constraint, NSUInteger priority, NSString *nametag);
 void RemoveConstraints(NSArray *constraints);
 
+// Batch installs and removals into one net change. Transactions
+// nest and are main-thread only. Removing a constraint and
+// installing an equal one, or one differing only by its constant,
+// is a replacement: at commit the old constraint comes off and the
+// new object goes on, so the caller's reference stays installed.
+// Removing the new object within the same transaction cancels the
+// replacement and the old constraint is simply removed. Commit
+// returns the net number of constraints added to or removed from
+// views; replacements are not counted
+void BeginConstraintTransaction(void);
+NSUInteger CommitConstraintTransaction(void);
+NSUInteger PerformConstraintTransaction(void (^block)(void));
+BOOL ConstraintTransactionInProgress(void);
+
 // Retrieve IB-generated constraints from a view controller root
 NSArray *ConstraintsSourcedFromIB(NSArray *constraints);
 
+// Filter constraints by their source. Classifications are cached per constraint
+NSArray *ConstraintsWithSourceType(NSArray *constraints, ConstraintSourceType sourceType);
+
 // If you use in production code, please make sure to add
 // namespace indicators to class category methods
 
 // Find nearest common ancestor
+// Predicates walk superview pointers directly and allocate nothing
 @interface VIEW_CLASS (HierarchySupport)
 @property (nonatomic, readonly) NSArray *superviews;
 @property (nonatomic, readonly) NSArray *allSubviews;
-- (BOOL) isAncestorOfView: (VIEW_CLASS *) aView;
+@property (nonatomic, readonly) NSUInteger depthInHierarchy; // root is 0
+- (BOOL) isAncestorOfView: (VIEW_CLASS *) aView; // strict
+- (BOOL) isSiblingOfView: (VIEW_CLASS *) aView;
+- (VIEW_CLASS *) ancestorAtDepth: (NSUInteger) depth; // self at own depth
 - (VIEW_CLASS *) nearestCommonAncestorToView: (VIEW_CLASS *) aView;
+#if TARGET_OS_IPHONE
+// UIKit supplies isDescendantOfView:
+#elif TARGET_OS_MAC
+- (BOOL) isDescendantOfView: (VIEW_CLASS *) aView; // inclusive, as in UIKit
+#endif
 @end
 
 // Convenience
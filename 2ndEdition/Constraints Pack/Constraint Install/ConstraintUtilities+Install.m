@@ -5,45 +5,360 @@
  */
 
 #import "ConstraintUtilities+Install.h"
+#import "ConstraintUtilities+Matching.h"
+#import "ConstraintUtilities+Index.h"
+#import "ConstraintUtilities+Instrumentation.h"
+#import "View-Traversal.h"
+
+#if TARGET_OS_IPHONE
+@import ObjectiveC;
+#elif TARGET_OS_MAC
+#import <objc/objc-runtime.h>
+#endif
+
+static VIEW_CLASS *NearestCommonAncestor(VIEW_CLASS *view1, VIEW_CLASS *view2);
+
+// Layout guides stand in for the view that owns them
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wundeclared-selector"
+static VIEW_CLASS *ItemView(id item)
+{
+    if (!item || [item isKindOfClass:[VIEW_CLASS class]])
+        return item;
+    if ([item respondsToSelector:@selector(owningView)])
+        return [item performSelector:@selector(owningView)];
+    return nil;
+}
+#pragma GCC diagnostic pop
+
+// Natural owner: the first view for unary constraints,
+// otherwise the nearest common ancestor of both items
+static VIEW_CLASS *ConstraintOwner(NSLayoutConstraint *constraint)
+{
+    if (!constraint.secondItem)
+        return ItemView(constraint.firstItem);
+    return NearestCommonAncestor(ItemView(constraint.firstItem), ItemView(constraint.secondItem));
+}
+
+// Removal prefers the view the index saw the constraint
+// installed on, which need not be the natural owner
+static VIEW_CLASS *InstalledOwner(NSLayoutConstraint *constraint)
+{
+    VIEW_CLASS *owner = constraint.indexedOwner;
+    return owner ? owner : ConstraintOwner(constraint);
+}
+
+// Owner-keyed buckets compare views by pointer, never by isEqual:
+static NSMapTable *OwnerBatchTable(void)
+{
+    return [NSMapTable mapTableWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory];
+}
+
+static void AddToOwnerBatch(NSMapTable *batches, VIEW_CLASS *owner, NSLayoutConstraint *constraint)
+{
+    NSMutableArray *batch = [batches objectForKey:owner];
+    if (!batch)
+    {
+        batch = [NSMutableArray array];
+        [batches setObject:batch forKey:owner];
+    }
+    [batch addObject:constraint];
+}
+
+// Hand each owner its constraints in a single addConstraints: call.
+// Returns the number handed to an owner
+static NSUInteger AddConstraintsByOwner(NSArray *constraints)
+{
+    CONSTRAINT_PROBE();
+    NSMapTable *batches = OwnerBatchTable();
+    for (NSLayoutConstraint *constraint in constraints)
+    {
+        VIEW_CLASS *owner = ConstraintOwner(constraint);
+        if (!owner)
+        {
+            NSLog(@"Error: Constraint cannot be installed. No common ancestor between items.");
+            continue;
+        }
+        AddToOwnerBatch(batches, owner, constraint);
+    }
+    
+    NSUInteger count = 0;
+    for (VIEW_CLASS *owner in batches)
+    {
+        NSArray *batch = [batches objectForKey:owner];
+        [owner addConstraints:batch];
+        ConstraintIndexNoteInstalled(batch, owner);
+        count += batch.count;
+    }
+    return count;
+}
+
+// Whether owner actually holds the constraint. The index answers
+// for pack installs; anything else falls back to owner's array
+static BOOL OwnerHolds(VIEW_CLASS *owner, NSLayoutConstraint *constraint, NSHashTable **held)
+{
+    if (constraint.indexedOwner == owner)
+        return YES;
+    if (!*held)
+    {
+        *held = [NSHashTable hashTableWithOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality];
+        for (NSLayoutConstraint *each in owner.constraints)
+            [*held addObject:each];
+    }
+    return [*held containsObject:constraint];
+}
+
+// Remove in one removeConstraints: call per owner.
+// Returns the number the owners actually held
+static NSUInteger RemoveConstraintsByOwner(NSArray *constraints)
+{
+    CONSTRAINT_PROBE();
+    NSMapTable *batches = OwnerBatchTable();
+    for (NSLayoutConstraint *constraint in constraints)
+    {
+        // If the constraint is not on its owner, removal is a no-op
+        VIEW_CLASS *owner = InstalledOwner(constraint);
+        if (owner)
+            AddToOwnerBatch(batches, owner, constraint);
+    }
+    
+    NSUInteger count = 0;
+    for (VIEW_CLASS *owner in batches)
+    {
+        NSArray *batch = [batches objectForKey:owner];
+        NSHashTable *held = nil;
+        for (NSLayoutConstraint *constraint in batch)
+        {
+            if (OwnerHolds(owner, constraint, &held))
+                count++;
+        }
+        [owner removeConstraints:batch];
+        ConstraintIndexNoteRemoved(batch, owner);
+    }
+    return count;
+}
+
+#pragma mark - Transactions
+
+// Transactions are main-thread only, like the views they touch
+static NSUInteger transactionDepth = 0;
+static NSMutableArray *pendingInstalls = nil;
+static NSMapTable *pendingRemovals = nil; // first item -> constraints
+static NSMapTable *pendingReplacements = nil; // caller's constraint -> constraint it replaces
+
+// Everything but the constant matches, priority included
+static BOOL DiffersOnlyByConstant(NSLayoutConstraint *constraint1, NSLayoutConstraint *constraint2)
+{
+    if (![constraint1.class isEqual:[NSLayoutConstraint class]]) return NO;
+    if (![constraint2.class isEqual:[NSLayoutConstraint class]]) return NO;
+    if (constraint1.firstItem != constraint2.firstItem) return NO;
+    if (constraint1.secondItem != constraint2.secondItem) return NO;
+    if (constraint1.firstAttribute != constraint2.firstAttribute) return NO;
+    if (constraint1.secondAttribute != constraint2.secondAttribute) return NO;
+    if (constraint1.relation != constraint2.relation) return NO;
+    if (constraint1.multiplier != constraint2.multiplier) return NO;
+    return (constraint1.priority == constraint2.priority);
+}
+
+// Pull a pending removal that the incoming constraint can replace
+static NSLayoutConstraint *TakePendingRemoval(NSLayoutConstraint *constraint, BOOL ignoringConstant)
+{
+    NSMutableArray *candidates = [pendingRemovals objectForKey:constraint.firstItem];
+    for (NSUInteger i = 0; i < candidates.count; i++)
+    {
+        NSLayoutConstraint *candidate = candidates[i];
+        BOOL match = ignoringConstant ?
+            DiffersOnlyByConstant(candidate, constraint) :
+            [candidate isEqualToLayoutConstraintConsideringPriority:constraint];
+        if (match)
+        {
+            [candidates removeObjectAtIndex:i];
+            return candidate;
+        }
+    }
+    return nil;
+}
+
+static void QueueInstall(NSLayoutConstraint *constraint)
+{
+    if ([pendingReplacements objectForKey:constraint])
+        return;
+    
+    // Reinstalling an equal constraint, or one that differs only by
+    // its constant, replaces the pending removal. The caller's object
+    // is the one installed at commit, so references to it stay good
+    NSLayoutConstraint *replaced = TakePendingRemoval(constraint, NO);
+    if (!replaced)
+        replaced = TakePendingRemoval(constraint, YES);
+    
+    if (replaced)
+    {
+        [pendingReplacements setObject:replaced forKey:constraint];
+        return;
+    }
+    
+    if ([pendingInstalls indexOfObjectIdenticalTo:constraint] == NSNotFound)
+        [pendingInstalls addObject:constraint];
+}
+
+static void QueueRemove(NSLayoutConstraint *constraint)
+{
+    // Removing a constraint that was never committed just drops it
+    NSUInteger index = [pendingInstalls indexOfObjectIdenticalTo:constraint];
+    if (index != NSNotFound)
+    {
+        [pendingInstalls removeObjectAtIndex:index];
+        return;
+    }
+    
+    // Removing a replacement cancels it. The constraint it
+    // replaced goes back to being an ordinary removal
+    NSLayoutConstraint *replaced = [pendingReplacements objectForKey:constraint];
+    if (replaced)
+    {
+        [pendingReplacements removeObjectForKey:constraint];
+        constraint = replaced;
+    }
+    
+    NSMutableArray *candidates = [pendingRemovals objectForKey:constraint.firstItem];
+    if (!candidates)
+    {
+        candidates = [NSMutableArray array];
+        [pendingRemovals setObject:candidates forKey:constraint.firstItem];
+    }
+    if ([candidates indexOfObjectIdenticalTo:constraint] == NSNotFound)
+        [candidates addObject:constraint];
+}
+
+// Transactions nest. Only the outermost commit touches the views
+void BeginConstraintTransaction(void)
+{
+    CONSTRAINT_PROBE();
+    if (transactionDepth++ > 0)
+        return;
+    pendingInstalls = [NSMutableArray array];
+    pendingRemovals = OwnerBatchTable();
+    pendingReplacements = OwnerBatchTable();
+}
+
+// Apply the net delta. Returns the number of constraints
+// actually removed from and added to views. Replacements swap
+// one constraint for its equal and are not counted
+NSUInteger CommitConstraintTransaction(void)
+{
+    CONSTRAINT_PROBE();
+    if (!transactionDepth)
+    {
+        NSLog(@"Error: No constraint transaction to commit.");
+        return 0;
+    }
+    if (--transactionDepth > 0)
+        return 0;
+    
+    NSMutableArray *removals = [NSMutableArray array];
+    for (id item in pendingRemovals)
+        [removals addObjectsFromArray:[pendingRemovals objectForKey:item]];
+    NSArray *installs = pendingInstalls;
+    NSMutableArray *replacements = [NSMutableArray array];
+    NSMutableArray *replaced = [NSMutableArray array];
+    for (NSLayoutConstraint *constraint in pendingReplacements)
+    {
+        [replacements addObject:constraint];
+        [replaced addObject:[pendingReplacements objectForKey:constraint]];
+    }
+    pendingInstalls = nil;
+    pendingRemovals = nil;
+    pendingReplacements = nil;
+    
+    NSUInteger count = RemoveConstraintsByOwner(removals);
+    RemoveConstraintsByOwner(replaced);
+    AddConstraintsByOwner(replacements);
+    count += AddConstraintsByOwner(installs);
+    return count;
+}
+
+NSUInteger PerformConstraintTransaction(void (^block)(void))
+{
+    CONSTRAINT_PROBE();
+    BeginConstraintTransaction();
+    if (block) block();
+    return CommitConstraintTransaction();
+}
+
+BOOL ConstraintTransactionInProgress(void)
+{
+    return transactionDepth > 0;
+}
+
+#pragma mark - Array Installation
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wundeclared-selector"
+// Resolve each owner once and install in per-owner batches
 void InstallConstraints(NSArray *constraints, NSUInteger priority, NSString *nametag)
 {
+    CONSTRAINT_PROBE();
+    // Nametags come from an optional pack. Check support once per batch
+    BOOL canTag = [NSLayoutConstraint instancesRespondToSelector:@selector(setNametag:)];
+    NSMutableArray *valid = [NSMutableArray arrayWithCapacity:constraints.count];
+    
     for (NSLayoutConstraint *constraint in constraints)
     {
         if (![constraint isKindOfClass:[NSLayoutConstraint class]])
             continue;
         if (priority)
-            [constraint install:priority];
-        else
-            [constraint install];
-        
-        if ([constraint respondsToSelector:@selector(setNametag:)])
-        {
+            constraint.priority = priority;
+        if (canTag)
             [constraint performSelector:@selector(setNametag:) withObject:nametag];
-        }
+        [valid addObject:constraint];
+    }
+    
+    if (!ConstraintTransactionInProgress())
+    {
+        AddConstraintsByOwner(valid);
+        return;
     }
+    
+    for (NSLayoutConstraint *constraint in valid)
+        QueueInstall(constraint);
 }
 
 void InstallConstraint(NSLayoutConstraint *constraint, NSUInteger priority, NSString *nametag)
 {
+    CONSTRAINT_PROBE();
     InstallConstraints(@[constraint], priority, nametag);
 }
 #pragma GCC diagnostic pop
 
 void RemoveConstraints(NSArray *constraints)
 {
+    CONSTRAINT_PROBE();
+    NSMutableArray *valid = [NSMutableArray arrayWithCapacity:constraints.count];
     for (NSLayoutConstraint *constraint in constraints)
     {
         if (![constraint isKindOfClass:[NSLayoutConstraint class]])
             continue;
-        [constraint remove];
+        if (![constraint.class isEqual:[NSLayoutConstraint class]])
+        {
+            NSLog(@"Error: Can only uninstall NSLayoutConstraint. %@ is an invalid class.", constraint.class.description);
+            continue;
+        }
+        [valid addObject:constraint];
     }
+    
+    if (!ConstraintTransactionInProgress())
+    {
+        RemoveConstraintsByOwner(valid);
+        return;
+    }
+    
+    for (NSLayoutConstraint *constraint in valid)
+        QueueRemove(constraint);
 }
 
 NSArray *ConstraintsSourcedFromIB(NSArray *constraints)
 {
+    CONSTRAINT_PROBE();
     NSMutableArray *results = [NSMutableArray array];
     for (NSLayoutConstraint *constraint in constraints)
     {
@@ -53,14 +368,110 @@ NSArray *ConstraintsSourcedFromIB(NSArray *constraints)
     return results;
 }
 
+#pragma mark - Source Classification
+
+// Identifiers arrived with iOS 7 and OS X 10.7. Check once
+static BOOL ConstraintsHaveIdentifiers(void)
+{
+    static BOOL hasIdentifiers = NO;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        hasIdentifiers = [NSLayoutConstraint instancesRespondToSelector:@selector(identifier)];
+    });
+    return hasIdentifiers;
+}
+
+// IB tags the constraints it generates. The identifier carries
+// the tag on its own. Fall back to the far costlier debug
+// description only when there is no identifier to read.
+// Results are memoized on the constraint
+static ConstraintSourceType ArchivedConstraintSourceType(NSLayoutConstraint *constraint)
+{
+    NSNumber *cached = objc_getAssociatedObject(constraint, @selector(sourceType));
+    if (cached)
+        return (ConstraintSourceType) cached.intValue;
+    
+    NSString *tag = ConstraintsHaveIdentifiers() ? constraint.identifier : nil;
+    if (!tag)
+        tag = constraint.debugDescription;
+    
+    ConstraintSourceType result = ConstraintSourceTypeSatisfaction;
+    if ([tag rangeOfString:@"ambiguity"].location != NSNotFound)
+        result = ConstraintSourceTypeDisambiguation;
+    else if ([tag rangeOfString:@"fixed frame"].location != NSNotFound)
+        result = ConstraintSourceTypeInferred;
+    
+    objc_setAssociatedObject(constraint, @selector(sourceType), @(result), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    return result;
+}
+
+// Classify in bulk, keeping only the requested source
+NSArray *ConstraintsWithSourceType(NSArray *constraints, ConstraintSourceType sourceType)
+{
+    CONSTRAINT_PROBE();
+    NSMutableArray *results = [NSMutableArray array];
+    for (NSLayoutConstraint *constraint in constraints)
+    {
+        if (![constraint isKindOfClass:[NSLayoutConstraint class]])
+            continue;
+        
+        // Anything not archived was built in code
+        ConstraintSourceType type = constraint.shouldBeArchived ?
+            ArchivedConstraintSourceType(constraint) :
+            ConstraintSourceTypeCustom;
+        if (type == sourceType)
+            [results addObject:constraint];
+    }
+    return results;
+}
+
 #pragma mark - Views
 
 #pragma mark - Hierarchy
+
+// Count the superviews above a view with a direct pointer walk
+static NSUInteger ViewDepth(VIEW_CLASS *view)
+{
+    NSUInteger depth = 0;
+    for (VIEW_CLASS *ancestor = view.superview; ancestor; ancestor = ancestor.superview)
+        depth++;
+    return depth;
+}
+
+// Raise the deeper view to the shallower view's depth, then walk both
+// upward in lockstep until they meet. O(depth), with no array building
+// and no containsObject: scans.
+static VIEW_CLASS *NearestCommonAncestor(VIEW_CLASS *view1, VIEW_CLASS *view2)
+{
+    CONSTRAINT_PROBE();
+    if (!view1 || !view2) return nil;
+    if (view1 == view2) return view1;
+    
+    NSUInteger depth1 = ViewDepth(view1);
+    NSUInteger depth2 = ViewDepth(view2);
+    
+    for (; depth1 > depth2; depth1--)
+        view1 = view1.superview;
+    for (; depth2 > depth1; depth2--)
+        view2 = view2.superview;
+    
+    // Covers direct superview relationships as well as siblings
+    while (view1 != view2)
+    {
+        view1 = view1.superview;
+        view2 = view2.superview;
+    }
+    
+    // Nil when the views live in separate hierarchies
+    return view1;
+}
+
 @implementation VIEW_CLASS (HierarchySupport)
 
 // Return an array of all superviews
 - (NSArray *) superviews
 {
+    CONSTRAINT_PROBE();
     NSMutableArray *array = [NSMutableArray array];
     VIEW_CLASS *view = self.superview;
     while (view)
@@ -72,47 +483,70 @@ NSArray *ConstraintsSourcedFromIB(NSArray *constraints)
     return array;
 }
 
-// Return an array of all subviews
+// Return an array of all subviews, depth first
 - (NSArray *) allSubviews
 {
+    CONSTRAINT_PROBE();
     NSMutableArray *array = [NSMutableArray array];
-    
-    for (VIEW_CLASS *view in self.subviews)
-    {
+    [self enumerateSubtreeWithOptions:ViewTraversalSkipRoot maxDepth:ViewTraversalNoDepthLimit usingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
         [array addObject:view];
-        [array addObjectsFromArray:[view allSubviews]];
-    }
-    
+    }];
     return array;
 }
 
 // Test if the current view has a superview relationship to a view
 - (BOOL) isAncestorOfView: (VIEW_CLASS *) aView
 {
-    return [aView.superviews containsObject:self];
+    CONSTRAINT_PROBE();
+    for (VIEW_CLASS *view = aView.superview; view != nil; view = view.superview)
+        if (view == self)
+            return YES;
+    return NO;
+}
+
+#if TARGET_OS_IPHONE
+#elif TARGET_OS_MAC
+// Matches UIKit, where a view is its own descendant
+- (BOOL) isDescendantOfView: (VIEW_CLASS *) aView
+{
+    CONSTRAINT_PROBE();
+    return (aView == self) || [aView isAncestorOfView:self];
+}
+#endif
+
+// Share a superview
+- (BOOL) isSiblingOfView: (VIEW_CLASS *) aView
+{
+    CONSTRAINT_PROBE();
+    if (!aView || (aView == self)) return NO;
+    return (self.superview != nil) && (self.superview == aView.superview);
+}
+
+// Number of superviews above the view
+- (NSUInteger) depthInHierarchy
+{
+    CONSTRAINT_PROBE();
+    return ViewDepth(self);
+}
+
+// Ancestor at an absolute depth, counting the root as 0
+- (VIEW_CLASS *) ancestorAtDepth: (NSUInteger) depth
+{
+    CONSTRAINT_PROBE();
+    NSUInteger ownDepth = ViewDepth(self);
+    if (depth > ownDepth) return nil;
+    
+    VIEW_CLASS *view = self;
+    for (NSUInteger steps = ownDepth - depth; steps > 0; steps--)
+        view = view.superview;
+    return view;
 }
 
 // Return the nearest common ancestor between self and another view
 - (VIEW_CLASS *) nearestCommonAncestorToView: (VIEW_CLASS *) aView
 {
-    // Check for same view
-    if (self == aView)
-        return self;
-    
-    // Check for direct superview relationship
-    if ([self isAncestorOfView:aView])
-        return self;
-    if ([aView isAncestorOfView:self])
-        return aView;
-    
-    // Search for indirect common ancestor
-    NSArray *ancestors = self.superviews;
-    for (VIEW_CLASS *view in aView.superviews)
-        if ([ancestors containsObject:view])
-            return view;
-    
-    // No common ancestor
-    return nil;
+    CONSTRAINT_PROBE();
+    return NearestCommonAncestor(self, aView);
 }
 @end
 
@@ -120,6 +554,7 @@ NSArray *ConstraintsSourcedFromIB(NSArray *constraints)
 @implementation VIEW_CLASS (ConstraintReadyViews)
 + (instancetype) view
 {
+    CONSTRAINT_PROBE();
     VIEW_CLASS *newView = [[VIEW_CLASS alloc] initWithFrame:CGRectZero];
     newView.translatesAutoresizingMaskIntoConstraints = NO;
     return newView;
@@ -130,16 +565,16 @@ NSArray *ConstraintsSourcedFromIB(NSArray *constraints)
 
 #pragma mark - View Hierarchy
 @implementation NSLayoutConstraint (ViewHierarchy)
-// Cast the first item to a view
+// Cast the first item to a view, nil for layout guides
 - (VIEW_CLASS *) firstView
 {
-    return self.firstItem;
+    return [self.firstItem isKindOfClass:[VIEW_CLASS class]] ? self.firstItem : nil;
 }
 
-// Cast the second item to a view
+// Cast the second item to a view, nil for layout guides
 - (VIEW_CLASS *) secondView
 {
-    return self.secondItem;
+    return [self.secondItem isKindOfClass:[VIEW_CLASS class]] ? self.secondItem : nil;
 }
 
 // Are two items involved or not
@@ -151,10 +586,8 @@ NSArray *ConstraintsSourcedFromIB(NSArray *constraints)
 // Return NCA
 - (VIEW_CLASS *) likelyOwner
 {
-    if (self.isUnary)
-        return self.firstView;
-    
-    return [self.firstView nearestCommonAncestorToView:self.secondView];
+    CONSTRAINT_PROBE();
+    return ConstraintOwner(self);
 }
 
 
@@ -164,19 +597,14 @@ NSArray *ConstraintsSourcedFromIB(NSArray *constraints)
  When a view is archived, it archives some but not all constraints in its -constraints array.  The value of shouldBeArchived informs UIView if a particular constraint should be archived by UIView / NSView. If a constraint is created at runtime in response to the state of the object, it isn't appropriate to archive the constraint - rather you archive the state that gives rise to the constraint.  Since the majority of constraints that should be archived are created in Interface Builder (which is smart enough to set this prop to YES), the default value for this property is NO.
  */
 
+// Code-built constraints answer immediately. IB constraints
+// are classified once and remembered
 - (ConstraintSourceType) sourceType
 {
-    ConstraintSourceType result = ConstraintSourceTypeCustom;
-    if (self.shouldBeArchived)
-    {
-        result = ConstraintSourceTypeSatisfaction;
-        NSString *description = self.debugDescription;
-        if ([description rangeOfString:@"ambiguity"].location != NSNotFound)
-            result = ConstraintSourceTypeDisambiguation;
-        else if ([description rangeOfString:@"fixed frame"].location != NSNotFound)
-            result = ConstraintSourceTypeInferred;
-    }
-    return result;
+    CONSTRAINT_PROBE();
+    if (!self.shouldBeArchived)
+        return ConstraintSourceTypeCustom;
+    return ArchivedConstraintSourceType(self);
 }
 @end
 
@@ -184,53 +612,59 @@ NSArray *ConstraintsSourcedFromIB(NSArray *constraints)
 @implementation NSLayoutConstraint (SelfInstall)
 - (BOOL) install
 {
-    // Handle Unary constraint
-    if (self.isUnary)
-    {
-        // Add weak owner reference
-        [self.firstView addConstraint:self];
-        return YES;
-    }
-    
-    // Install onto nearest common ancestor
-    VIEW_CLASS *view = [self.firstView nearestCommonAncestorToView:self.secondView];
+    CONSTRAINT_PROBE();
+    // Install onto nearest common ancestor or, for unary
+    // constraints, onto the first view
+    VIEW_CLASS *view = ConstraintOwner(self);
     if (!view)
     {
         NSLog(@"Error: Constraint cannot be installed. No common ancestor between items.");
         return NO;
     }
     
-    [view addConstraint:self];    
+    // Defer to any open transaction
+    if (ConstraintTransactionInProgress())
+    {
+        QueueInstall(self);
+        return YES;
+    }
+    
+    [view addConstraint:self];
+    ConstraintIndexNoteInstalled(@[self], view);
     return YES;
 }
 
 // Set priority and install
 - (BOOL) install: (float) priority
 {
+    CONSTRAINT_PROBE();
     self.priority = priority;
     return [self install];
 }
 
 - (void) remove
 {
+    CONSTRAINT_PROBE();
     if (![self.class isEqual:[NSLayoutConstraint class]])
     {
         NSLog(@"Error: Can only uninstall NSLayoutConstraint. %@ is an invalid class.", self.class.description);
         return;
     }
     
-    if (self.isUnary)
+    // Defer to any open transaction
+    if (ConstraintTransactionInProgress())
     {
-        VIEW_CLASS *view = self.firstView;
-        [view removeConstraint:self];
+        QueueRemove(self);
         return;
     }
     
-    // Remove from preferred recipient
-    VIEW_CLASS *view = [self.firstView nearestCommonAncestorToView:self.secondView];
+    // Remove from the recorded owner or else the preferred
+    // recipient: the first view for unary constraints, the NCA otherwise
+    VIEW_CLASS *view = InstalledOwner(self);
     if (!view) return;
     
     // If the constraint not on view, this is a no-op
     [view removeConstraint:self];
+    ConstraintIndexNoteRemoved(@[self], view);
 }
 @end
\ No newline at end of file
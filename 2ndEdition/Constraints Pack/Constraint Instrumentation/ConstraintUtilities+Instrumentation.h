@@ -0,0 +1,88 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#if TARGET_OS_IPHONE
+@import Foundation;
+#elif TARGET_OS_MAC
+#import <Foundation/Foundation.h>
+#endif
+
+/*
+ INSTRUMENTATION
+ Opt-in probes on the pack's entry points. Each probe counts calls
+ and wall time per call site. Probes compile out entirely unless
+ you build with CONSTRAINT_PACK_INSTRUMENTATION set:
+ 
+   1  call counts and wall time
+   2  also allocation counts and bytes allocated
+ 
+ Every thread records into its own counters, so probes take no locks.
+ Snapshots add up all threads' counters without stopping them. Times
+ are inclusive: a probed routine that calls another includes the
+ callee's time, and both count the call.
+ 
+ Level 2 counts every malloc, calloc and realloc the probing thread
+ makes inside a probe, whichever zone serves it. Frees are not
+ subtracted: these are allocations made, not memory held. Counting
+ replaces libmalloc's private malloc_logger hook, chained to any
+ logger already there, so it also needs CONSTRAINT_PROBE_MALLOC set
+ to 1. Without it, level 2 reports zero allocations. With it, every
+ allocation in the process, on any thread, pays a call and a
+ thread-specific lookup while the app runs. The hook is private
+ SPI: use it for debug profiling runs only, never in builds you ship.
+ */
+
+#ifndef CONSTRAINT_PACK_INSTRUMENTATION
+#define CONSTRAINT_PACK_INSTRUMENTATION 0
+#endif
+
+#ifndef CONSTRAINT_PROBE_MALLOC
+#define CONSTRAINT_PROBE_MALLOC 0
+#endif
+
+#if CONSTRAINT_PACK_INSTRUMENTATION
+
+// Call sites register on first use
+typedef struct
+{
+    const char *name;
+    _Atomic(int) index; // -1 until registered
+} ConstraintProbeSite;
+
+typedef struct
+{
+    int index;
+    uint64_t start;
+    uint64_t allocations;
+    uint64_t bytes;
+} ConstraintProbeFrame;
+
+ConstraintProbeFrame ConstraintProbeEnter(ConstraintProbeSite *site);
+void ConstraintProbeLeave(ConstraintProbeFrame *frame);
+
+// Place at the top of a function or method. The probe closes
+// when the enclosing scope exits, however it exits
+#define CONSTRAINT_PROBE() \
+    static ConstraintProbeSite _constraintProbeSite = {__func__, -1}; \
+    __attribute__((cleanup(ConstraintProbeLeave), unused)) ConstraintProbeFrame _constraintProbeFrame = ConstraintProbeEnter(&_constraintProbeSite)
+
+#else
+
+#define CONSTRAINT_PROBE()
+
+#endif
+
+// Snapshot of every probe with calls since the last reset, slowest
+// first. Each entry holds name, calls, milliseconds, allocations and
+// bytes. Empty when instrumentation is compiled out
+NSArray *ConstraintProbeSnapshot(void);
+
+// Zero the totals reported by later snapshots
+void ResetConstraintProbes(void);
+
+// Print the snapshot to stdout. Does nothing when instrumentation
+// is compiled out
+void ListConstraintProbes(void);
@@ -0,0 +1,283 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#import "ConstraintUtilities+Instrumentation.h"
+
+#if CONSTRAINT_PACK_INSTRUMENTATION
+
+#import <stdatomic.h>
+#import <pthread.h>
+#import <mach/mach_time.h>
+
+// Fixed site table. Sites past the limit go uncounted
+#define CONSTRAINT_PROBE_SITES 512
+
+#pragma mark - Sites
+
+static _Atomic(int) probeSiteCount = 0;
+static _Atomic(const char *) probeSiteNames[CONSTRAINT_PROBE_SITES];
+
+// Two threads may race to register one site. The loser's slot
+// stays empty and is never reported
+static int ProbeSiteIndex(ConstraintProbeSite *site)
+{
+    int index = atomic_load_explicit(&site->index, memory_order_acquire);
+    if (index >= 0)
+        return index;
+    
+    int claimed = atomic_fetch_add_explicit(&probeSiteCount, 1, memory_order_relaxed);
+    if (claimed >= CONSTRAINT_PROBE_SITES)
+        return -1;
+    atomic_store_explicit(&probeSiteNames[claimed], site->name, memory_order_release);
+    
+    int expected = -1;
+    if (atomic_compare_exchange_strong_explicit(&site->index, &expected, claimed, memory_order_acq_rel, memory_order_acquire))
+        return claimed;
+    return expected;
+}
+
+#pragma mark - Per-Thread Counters
+
+// Written only by the owning thread, read by snapshots
+typedef struct
+{
+    _Atomic(uint64_t) calls;
+    _Atomic(uint64_t) ticks;
+    _Atomic(uint64_t) allocations;
+    _Atomic(uint64_t) bytes;
+} ConstraintProbeCounters;
+
+// Thread records are pushed onto a lock-free list and never freed,
+// so their totals survive the thread. The running allocation
+// tallies belong to the thread alone; probes take differences
+typedef struct ConstraintProbeThread
+{
+    ConstraintProbeCounters counters[CONSTRAINT_PROBE_SITES];
+    uint64_t allocations;
+    uint64_t bytes;
+    struct ConstraintProbeThread *next;
+} ConstraintProbeThread;
+
+static _Atomic(ConstraintProbeThread *) probeThreads = NULL;
+static pthread_key_t probeThreadKey;
+
+// malloc_logger is private libmalloc SPI, not API. Replacing it is a
+// debugging technique only, so level 2 touches it solely when the
+// build also sets CONSTRAINT_PROBE_MALLOC
+#define CONSTRAINT_PROBE_COUNTS_ALLOCATIONS ((CONSTRAINT_PACK_INSTRUMENTATION > 1) && CONSTRAINT_PROBE_MALLOC)
+#if (CONSTRAINT_PACK_INSTRUMENTATION > 1) && !CONSTRAINT_PROBE_MALLOC
+#warning Level 2 instrumentation reports zero allocations unless CONSTRAINT_PROBE_MALLOC is set
+#endif
+
+#if CONSTRAINT_PROBE_COUNTS_ALLOCATIONS
+#pragma mark - Allocation Logger
+
+// libmalloc reports each allocation to malloc_logger, the hook
+// malloc stack logging uses, on the allocating thread
+typedef void (ConstraintMallocLogger)(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t skippedFrames);
+extern ConstraintMallocLogger *malloc_logger;
+
+#define MallocLogAllocate 2
+#define MallocLogDeallocate 4
+#define MallocLogVMAllocate 16
+
+static ConstraintMallocLogger *previousMallocLogger = NULL;
+
+// Runs inside malloc, so it must not allocate. pthread_getspecific
+// never does; threads that have not probed yet are skipped
+static void ProbeMallocLogger(uint32_t type, uintptr_t arg1, uintptr_t arg2, uintptr_t arg3, uintptr_t result, uint32_t skippedFrames)
+{
+    if (previousMallocLogger)
+        previousMallocLogger(type, arg1, arg2, arg3, result, skippedFrames + 1);
+    if (!(type & MallocLogAllocate) || (type & MallocLogVMAllocate) || !result)
+        return;
+    
+    ConstraintProbeThread *thread = pthread_getspecific(probeThreadKey);
+    if (!thread)
+        return;
+    
+    // realloc passes the old block in arg2 and the new size in arg3
+    thread->allocations++;
+    thread->bytes += (type & MallocLogDeallocate) ? arg3 : arg2;
+}
+#endif
+
+static ConstraintProbeThread *CurrentProbeThread(void)
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pthread_key_create(&probeThreadKey, NULL);
+#if CONSTRAINT_PROBE_COUNTS_ALLOCATIONS
+        previousMallocLogger = malloc_logger;
+        malloc_logger = ProbeMallocLogger;
+#endif
+    });
+    
+    ConstraintProbeThread *thread = pthread_getspecific(probeThreadKey);
+    if (thread)
+        return thread;
+    
+    thread = calloc(1, sizeof(ConstraintProbeThread));
+    ConstraintProbeThread *head = atomic_load_explicit(&probeThreads, memory_order_relaxed);
+    do {
+        thread->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&probeThreads, &head, thread, memory_order_release, memory_order_relaxed));
+    
+    pthread_setspecific(probeThreadKey, thread);
+    return thread;
+}
+
+// Single writer, so a relaxed load and store is enough
+static inline void ProbeAdd(_Atomic(uint64_t) *counter, uint64_t amount)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + amount, memory_order_relaxed);
+}
+
+#pragma mark - Probes
+
+ConstraintProbeFrame ConstraintProbeEnter(ConstraintProbeSite *site)
+{
+    ConstraintProbeFrame frame = {0};
+    frame.index = ProbeSiteIndex(site);
+#if CONSTRAINT_PROBE_COUNTS_ALLOCATIONS
+    ConstraintProbeThread *thread = CurrentProbeThread();
+    frame.allocations = thread->allocations;
+    frame.bytes = thread->bytes;
+#endif
+    frame.start = mach_absolute_time();
+    return frame;
+}
+
+void ConstraintProbeLeave(ConstraintProbeFrame *frame)
+{
+    uint64_t elapsed = mach_absolute_time() - frame->start;
+    if (frame->index < 0)
+        return;
+    
+    ConstraintProbeThread *thread = CurrentProbeThread();
+    ConstraintProbeCounters *counters = &thread->counters[frame->index];
+    ProbeAdd(&counters->calls, 1);
+    ProbeAdd(&counters->ticks, elapsed);
+#if CONSTRAINT_PROBE_COUNTS_ALLOCATIONS
+    ProbeAdd(&counters->allocations, thread->allocations - frame->allocations);
+    ProbeAdd(&counters->bytes, thread->bytes - frame->bytes);
+#endif
+}
+
+#pragma mark - Aggregation
+
+typedef struct
+{
+    uint64_t calls;
+    uint64_t ticks;
+    uint64_t allocations;
+    uint64_t bytes;
+} ConstraintProbeTotals;
+
+// Totals as of the last reset. Guarded by the lock below, which
+// only snapshot and reset take. Probes never touch it
+static ConstraintProbeTotals probeBaseline[CONSTRAINT_PROBE_SITES];
+static pthread_mutex_t probeBaselineLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void SumProbeThreads(ConstraintProbeTotals *totals, int count)
+{
+    memset(totals, 0, sizeof(ConstraintProbeTotals) * count);
+    for (ConstraintProbeThread *thread = atomic_load_explicit(&probeThreads, memory_order_acquire); thread; thread = thread->next)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            ConstraintProbeCounters *counters = &thread->counters[i];
+            totals[i].calls += atomic_load_explicit(&counters->calls, memory_order_relaxed);
+            totals[i].ticks += atomic_load_explicit(&counters->ticks, memory_order_relaxed);
+            totals[i].allocations += atomic_load_explicit(&counters->allocations, memory_order_relaxed);
+            totals[i].bytes += atomic_load_explicit(&counters->bytes, memory_order_relaxed);
+        }
+    }
+}
+
+static int ProbeSitesInUse(void)
+{
+    return MIN(atomic_load_explicit(&probeSiteCount, memory_order_acquire), CONSTRAINT_PROBE_SITES);
+}
+
+NSArray *ConstraintProbeSnapshot(void)
+{
+    static mach_timebase_info_data_t timebase;
+    if (!timebase.denom)
+        mach_timebase_info(&timebase);
+    
+    int count = ProbeSitesInUse();
+    ConstraintProbeTotals totals[CONSTRAINT_PROBE_SITES];
+    SumProbeThreads(totals, count);
+    
+    NSMutableArray *results = [NSMutableArray array];
+    pthread_mutex_lock(&probeBaselineLock);
+    for (int i = 0; i < count; i++)
+    {
+        const char *name = atomic_load_explicit(&probeSiteNames[i], memory_order_acquire);
+        uint64_t calls = totals[i].calls - probeBaseline[i].calls;
+        if (!name || !calls)
+            continue;
+    
+        uint64_t ticks = totals[i].ticks - probeBaseline[i].ticks;
+        double milliseconds = (double) ticks * timebase.numer / timebase.denom / 1.0e6;
+        [results addObject:@{
+            @"name" : @(name),
+            @"calls" : @(calls),
+            @"milliseconds" : @(milliseconds),
+            @"allocations" : @(totals[i].allocations - probeBaseline[i].allocations),
+            @"bytes" : @(totals[i].bytes - probeBaseline[i].bytes),
+        }];
+    }
+    pthread_mutex_unlock(&probeBaselineLock);
+    
+    [results sortUsingComparator:^NSComparisonResult(NSDictionary *entry1, NSDictionary *entry2) {
+        return [entry2[@"milliseconds"] compare:entry1[@"milliseconds"]];
+    }];
+    return results;
+}
+
+void ResetConstraintProbes(void)
+{
+    pthread_mutex_lock(&probeBaselineLock);
+    SumProbeThreads(probeBaseline, ProbeSitesInUse());
+    pthread_mutex_unlock(&probeBaselineLock);
+}
+
+#pragma mark - Listing
+
+void ListConstraintProbes(void)
+{
+    NSArray *snapshot = ConstraintProbeSnapshot();
+    printf("<Constraint Pack Probes> (%d sites)\n", (int) snapshot.count);
+    int i = 1;
+    for (NSDictionary *entry in snapshot)
+        printf("%2d. %8.3f ms %8llu calls %8llu allocs %10llu bytes: %s\n",
+               i++,
+               [entry[@"milliseconds"] doubleValue],
+               [entry[@"calls"] unsignedLongLongValue],
+               [entry[@"allocations"] unsignedLongLongValue],
+               [entry[@"bytes"] unsignedLongLongValue],
+               [entry[@"name"] UTF8String]);
+    printf("\n");
+}
+
+#else
+
+NSArray *ConstraintProbeSnapshot(void)
+{
+    return @[];
+}
+
+void ResetConstraintProbes(void)
+{
+}
+
+void ListConstraintProbes(void)
+{
+}
+
+#endif
@@ -50,12 +50,38 @@ void MatchSizesH(NSArray *views, NSUInteger priority);
 void MatchSizesV(NSArray *views, NSUInteger priority);
 
 
-// Rows and Columns
+// Spacers. PseudoDistributeWithSpacers() and FloatViewsH/V() space
+// views with layout guides, which add no views, layers or rendering.
+// Before iOS 9 and OS X 10.11, by choice, or when aligning
+// baselines, which guides lack, they add empty spacer views instead.
+// Spacers and their constraints stay until you remove them: each
+// call adds more. RemoveDistributionSpacers() removes everything the
+// distributions on a view have created and returns the spacer count
+typedef enum
+{
+    ConstraintSpacerGuides = 0,     // where available
+    ConstraintSpacerViews,
+} ConstraintSpacerStyle;
+
+void SetConstraintSpacerStyle(ConstraintSpacerStyle style);
+ConstraintSpacerStyle CurrentConstraintSpacerStyle(void);
+BOOL SpacersAreLayoutGuides(void);
+NSUInteger RemoveDistributionSpacers(VIEW_CLASS *view);
+
+// Rows and Columns. Spacing is a connection such as @"-", @"" or
+// @"-(>=8@750)-". Each call installs its constraints as one batch
 void BuildLineWithSpacing(NSArray *views, NSLayoutFormatOptions alignment, NSString *spacing, NSUInteger priority);
 void BuildLine(NSArray *views, NSLayoutFormatOptions alignment, NSUInteger priority);
 void PseudoDistributeWithSpacers(VIEW_CLASS *superview, NSArray *views, NSLayoutFormatOptions alignment, NSUInteger priority);
 void PseudoDistributeCenters(NSArray *views, NSLayoutFormatOptions alignment, NSUInteger priority);
 
+// Grids fill rows of columns views, in order, with equal-width columns.
+// The last row may be short. Rows align on the vertical alignment
+// option (CenterY when 0) and stack from the first column, so put the
+// tallest views there. Pin the first view wherever you want the grid.
+// Returns the number of constraints, 3n - 3 for a full grid of n views
+NSUInteger BuildGrid(NSArray *views, NSUInteger columns, CGFloat rowSpacing, CGFloat columnSpacing, NSLayoutFormatOptions alignment, NSUInteger priority);
+
 // Floating
 void FloatViewsH(VIEW_CLASS *firstView, VIEW_CLASS *lastView, NSUInteger priority);
 void FloatViewsV(VIEW_CLASS *firstView, VIEW_CLASS *lastView, NSUInteger priority);
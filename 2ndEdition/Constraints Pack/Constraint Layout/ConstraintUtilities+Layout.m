@@ -6,10 +6,15 @@
 
 #import "ConstraintUtilities+Layout.h"
 #import "ConstraintUtilities+Matching.h"
+#import "ConstraintUtilities+VisualTemplates.h"
+#import "VisualFormatDialect.h"
 #import "NametagUtilities.h"
+#import "ConstraintUtilities+Instrumentation.h"
 
 #if TARGET_OS_IPHONE
+@import ObjectiveC;
 #elif TARGET_OS_MAC
+#import <objc/objc-runtime.h>
 #import "NSView+BackgroundColor.h"
 #endif
 
@@ -18,6 +23,7 @@
 // Paranoia in action.
 NSLayoutAttribute AttributeForAlignment(NSLayoutFormatOptions alignment)
 {
+    CONSTRAINT_PROBE();
     switch (alignment)
     {
         case NSLayoutFormatAlignAllLeft:
@@ -45,14 +51,41 @@ NSLayoutAttribute AttributeForAlignment(NSLayoutFormatOptions alignment)
 
 BOOL ConstraintIsHorizontal(NSLayoutConstraint *constraint)
 {
+    CONSTRAINT_PROBE();
     return IS_HORIZONTAL_ATTRIBUTE(constraint.firstAttribute);
 }
 
+#pragma mark - Build and Install
+
+// Wrapping the NSLayoutConstraint method into a function that
+// performs generation. Applies fallback priority
+// to any item not already prioritized by the format string.
+// Each format parses once, then builds from its template
+NSArray *VisualConstraints(NSString *format, NSLayoutFormatOptions options, NSDictionary *metrics, NSDictionary *bindings, NSUInteger fallbackPriority)
+{
+    CONSTRAINT_PROBE();
+    NSArray *constraints = TemplateConstraints(format, options, metrics, bindings);
+    for (NSLayoutConstraint *constraint in constraints)
+        if (constraint.priority == LayoutPriorityRequired)
+            constraint.priority = fallbackPriority;
+    
+    return constraints;
+}
+
+// Generate and then install constraints with naming
+void AddVisualConstraints(NSString *format, NSLayoutFormatOptions options, NSDictionary *metrics, NSDictionary *bindings, NSUInteger fallbackPriority, NSString *name)
+{
+    CONSTRAINT_PROBE();
+    NSArray *constraints = VisualConstraints(format, options, metrics, bindings, fallbackPriority);
+    InstallConstraints(constraints, 0, name);
+}
+
 #pragma mark - Visibility
 
 // Constrain within superview with minimum sizing
 void SizeAndConstrainToSuperview(VIEW_CLASS *view, float side, NSUInteger  priority)
 {
+    CONSTRAINT_PROBE();
     if (!view || !view.superview)
         return;
     
@@ -65,7 +98,7 @@ void SizeAndConstrainToSuperview(VIEW_CLASS *view, float side, NSUInteger  prior
          @"V:|->=0-[view(==side)]",
          @"V:[view]->=0-|"])
     {
-        NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:format options:0 metrics:metrics views:bindings];
+        NSArray *constraints = TemplateConstraints(format, 0, metrics, bindings);
         InstallConstraints(constraints, priority, @"Constrain to Superview");
     }
 }
@@ -73,6 +106,7 @@ void SizeAndConstrainToSuperview(VIEW_CLASS *view, float side, NSUInteger  prior
 // Constrain to superview
 void ConstrainToSuperview(VIEW_CLASS *view, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     if (!view || !view.superview)
         return;
     
@@ -82,7 +116,7 @@ void ConstrainToSuperview(VIEW_CLASS *view, NSUInteger priority)
                                @"V:|->=0-[view]",
                                @"V:[view]->=0-|"])
     {
-        NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:format options:0 metrics:nil views:@{@"view":view}];
+        NSArray *constraints = TemplateConstraints(format, 0, nil, @{@"view":view});
         InstallConstraints(constraints, priority, @"Constrain to Superview");
     }
 }
@@ -90,24 +124,27 @@ void ConstrainToSuperview(VIEW_CLASS *view, NSUInteger priority)
 #pragma mark - Stretching
 void StretchHorizontallyToSuperview(VIEW_CLASS *view, CGFloat indent, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     NSString *format = @"H:|-indent-[view]-indent-|";
     NSDictionary *bindings = NSDictionaryOfVariableBindings(view);
     NSDictionary *metrics = @{@"indent":@(indent)};
-    NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:format options:0 metrics:metrics views:bindings];
+    NSArray *constraints = TemplateConstraints(format, 0, metrics, bindings);
     InstallConstraints(constraints, priority, @"Stretch to Superview");
 }
 
 void StretchVerticallyToSuperview(VIEW_CLASS *view, CGFloat indent, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     NSString *format = @"V:|-indent-[view]-indent-|";
     NSDictionary *bindings = NSDictionaryOfVariableBindings(view);
     NSDictionary *metrics = @{@"indent":@(indent)};
-    NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:format options:0 metrics:metrics views:bindings];
+    NSArray *constraints = TemplateConstraints(format, 0, metrics, bindings);
     InstallConstraints(constraints, priority, @"Stretch to Superview");
 }
 
 void StretchToSuperview(VIEW_CLASS *view, CGFloat indent, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     StretchHorizontallyToSuperview(view, indent, priority);
     StretchVerticallyToSuperview(view, indent, priority);
 }
@@ -118,28 +155,35 @@ void _ConstrainViewSize(VIEW_CLASS *view, CGSize size, NSUInteger priority, NSSt
     NSDictionary *bindings = NSDictionaryOfVariableBindings(view);
     NSDictionary *metrics = @{@"width":@(size.width), @"height":@(size.height)};
     
-    for (NSString *format in @[
-         [NSString stringWithFormat:@"H:[view(%@width)]", relation],
-         [NSString stringWithFormat:@"V:[view(%@height)]", relation],
-         ])
+    // Constant formats keep template lookups free of string building
+    NSArray *formats = @[@"H:[view(==width)]", @"V:[view(==height)]"];
+    if ([relation isEqualToString:@">="])
+        formats = @[@"H:[view(>=width)]", @"V:[view(>=height)]"];
+    else if ([relation isEqualToString:@"<="])
+        formats = @[@"H:[view(<=width)]", @"V:[view(<=height)]"];
+    
+    for (NSString *format in formats)
     {
-        NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:format options:0 metrics:metrics views:bindings];
+        NSArray *constraints = TemplateConstraints(format, 0, metrics, bindings);
         InstallConstraints(constraints, priority, @"Sizing");
     }
 }
 
 void ConstrainViewSize(VIEW_CLASS *view, CGSize size, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     _ConstrainViewSize(view, size, priority, @"==");
 }
 
 void ConstrainMinimumViewSize(VIEW_CLASS *view, CGSize size, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     _ConstrainViewSize(view, size, priority, @">=");
 }
 
 void ConstrainMaximumViewSize(VIEW_CLASS *view, CGSize size, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     _ConstrainViewSize(view, size, priority, @"<=");
 }
 
@@ -147,70 +191,231 @@ void ConstrainMaximumViewSize(VIEW_CLASS *view, CGSize size, NSUInteger priority
 
 void MatchSizeH(VIEW_CLASS *view1, VIEW_CLASS *view2, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     NSString *formatString = @"H:[view1(==view2)]";
     NSDictionary *bindings = NSDictionaryOfVariableBindings(view1, view2);
-    NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:formatString options:0 metrics:nil views:bindings];
+    NSArray *constraints = TemplateConstraints(formatString, 0, nil, bindings);
     InstallConstraints(constraints, priority, @"Match Horizontal Size");
 }
 
 void MatchSizeV(VIEW_CLASS *view1, VIEW_CLASS *view2, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     NSString *formatString = @"V:[view1(==view2)]";
     NSDictionary *bindings = NSDictionaryOfVariableBindings(view1, view2);
-    NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:formatString options:0 metrics:nil views:bindings];
+    NSArray *constraints = TemplateConstraints(formatString, 0, nil, bindings);
     InstallConstraints(constraints, priority, @"Match Vertical Size");}
 
 void MatchSize(VIEW_CLASS *view1, VIEW_CLASS *view2, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     MatchSizeH(view1, view2, priority);
     MatchSizeV(view1, view2, priority);
 }
 
-void MatchSizesH(NSArray *views, NSUInteger priority)
+// The first view matches each of the others, installed as one batch
+void _MatchSizes(NSArray *views, NSLayoutAttribute attribute, NSUInteger priority, NSString *name)
 {
     if (views.count < 2) return;
     VIEW_CLASS *baseView = views[0];
-    for (int i = 1; i < views.count; i++)
-        MatchSizeH(baseView, views[i], priority);
+    NSMutableArray *constraints = [NSMutableArray arrayWithCapacity:views.count - 1];
+    for (NSUInteger i = 1; i < views.count; i++)
+        [constraints addObject:[NSLayoutConstraint constraintWithItem:baseView attribute:attribute relatedBy:NSLayoutRelationEqual toItem:views[i] attribute:attribute multiplier:1 constant:0]];
+    InstallConstraints(constraints, priority, name);
+}
+
+void MatchSizesH(NSArray *views, NSUInteger priority)
+{
+    CONSTRAINT_PROBE();
+    _MatchSizes(views, NSLayoutAttributeWidth, priority, @"Match Horizontal Size");
 }
 
 void MatchSizesV(NSArray *views, NSUInteger priority)
 {
-    if (views.count < 2) return;
-    VIEW_CLASS *baseView = views[0];
-    for (int i = 1; i < views.count; i++)
-        MatchSizeV(baseView, views[i], priority);
+    CONSTRAINT_PROBE();
+    _MatchSizes(views, NSLayoutAttributeHeight, priority, @"Match Vertical Size");
+}
+
+#pragma mark - Spacers
+
+static ConstraintSpacerStyle spacerStyle = ConstraintSpacerGuides;
+static char DistributionRecordKey;
+
+// What distributions added to a view, for RemoveDistributionSpacers()
+@interface DistributionRecord : NSObject
+@property (nonatomic, strong) NSMutableArray *spacers;
+@property (nonatomic, strong) NSMutableArray *constraints;
+@end
+
+@implementation DistributionRecord
+@end
+
+static DistributionRecord *RecordForView(VIEW_CLASS *view, BOOL create)
+{
+    DistributionRecord *record = objc_getAssociatedObject(view, &DistributionRecordKey);
+    if (!record && create)
+    {
+        record = [[DistributionRecord alloc] init];
+        record.spacers = [NSMutableArray array];
+        record.constraints = [NSMutableArray array];
+        objc_setAssociatedObject(view, &DistributionRecordKey, record, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    return record;
+}
+
+// Layout guides arrived in iOS 9 and OS X 10.11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wundeclared-selector"
+static Class LayoutGuideClass(void)
+{
+    static Class guideClass = Nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+#if TARGET_OS_IPHONE
+        guideClass = NSClassFromString(@"UILayoutGuide");
+#elif TARGET_OS_MAC
+        guideClass = NSClassFromString(@"NSLayoutGuide");
+#endif
+        if (![VIEW_CLASS instancesRespondToSelector:@selector(addLayoutGuide:)])
+            guideClass = Nil;
+    });
+    return guideClass;
+}
+
+void SetConstraintSpacerStyle(ConstraintSpacerStyle style)
+{
+    CONSTRAINT_PROBE();
+    spacerStyle = style;
+}
+
+ConstraintSpacerStyle CurrentConstraintSpacerStyle(void)
+{
+    CONSTRAINT_PROBE();
+    return spacerStyle;
+}
+
+BOOL SpacersAreLayoutGuides(void)
+{
+    CONSTRAINT_PROBE();
+    return (spacerStyle == ConstraintSpacerGuides) && LayoutGuideClass();
+}
+
+// A guide or a view, recorded on its owner. Either one takes the
+// same attribute constraints, except baselines, which only views
+// have. Callers needing a baseline pass NO for allowGuide
+static id AddSpacer(VIEW_CLASS *owner, NSString *nametag, BOOL allowGuide)
+{
+    id spacer;
+    if (allowGuide && SpacersAreLayoutGuides())
+    {
+        spacer = [[LayoutGuideClass() alloc] init];
+        [owner performSelector:@selector(addLayoutGuide:) withObject:spacer];
+    }
+    else
+    {
+        spacer = [[VIEW_CLASS alloc] init];
+        PREPCONSTRAINTS(spacer);
+        [owner addSubview:spacer];
+    }
+    
+    [spacer setNametag:nametag];
+    [RecordForView(owner, YES).spacers addObject:spacer];
+    return spacer;
+}
+
+NSUInteger RemoveDistributionSpacers(VIEW_CLASS *view)
+{
+    CONSTRAINT_PROBE();
+    DistributionRecord *record = RecordForView(view, NO);
+    if (!record) return 0;
+    
+    // Constraints first, so the index lets go of them
+    RemoveConstraints(record.constraints);
+    for (id spacer in record.spacers)
+    {
+        if ([spacer isKindOfClass:[VIEW_CLASS class]])
+            [spacer removeFromSuperview];
+        else
+            [view performSelector:@selector(removeLayoutGuide:) withObject:spacer];
+    }
+    
+    objc_setAssociatedObject(view, &DistributionRecordKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    return record.spacers.count;
 }
+#pragma GCC diagnostic pop
 
 #pragma mark - Rows and Columns
+
+// Read a spacing such as @"-", @"" or @"-(>=8@750)-" once, as the
+// specs for a single [view1]spacing[view2] pair. Item 0 is view1
+static BOOL ParseLineSpacing(NSString *axisString, NSString *spacing, VFLParseResult *result)
+{
+    NSString *format = [NSString stringWithFormat:@"%@[view1]%@[view2]", axisString, spacing ? : @""];
+    const char *source = format.UTF8String;
+    if (!VFLParse(source, strlen(source), result))
+    {
+        NSLog(@"Error: Cannot read line spacing \"%@\": %s", spacing, result->error);
+        VFLParseResultRelease(result);
+        return NO;
+    }
+    
+    // Spacing connects the pair and nothing else
+    BOOL valid = (result->nameCount == 2);
+    for (size_t i = 0; valid && (i < result->specCount); i++)
+        valid = (result->specs[i].firstItem >= 0) && (result->specs[i].secondItem >= 0);
+    if (!valid)
+    {
+        NSLog(@"Error: Line spacing \"%@\" must only connect neighboring views", spacing);
+        VFLParseResultRelease(result);
+        return NO;
+    }
+    return YES;
+}
+
+static NSLayoutConstraint *ConstraintForLineSpec(VFLConstraintSpec spec, VIEW_CLASS *view1, VIEW_CLASS *view2)
+{
+    NSLayoutConstraint *constraint = [NSLayoutConstraint constraintWithItem:(spec.firstItem ? view2 : view1) attribute:(NSLayoutAttribute) spec.firstAttribute relatedBy:(NSLayoutRelation) spec.relation toItem:(spec.secondItem ? view2 : view1) attribute:(NSLayoutAttribute) spec.secondAttribute multiplier:spec.multiplier constant:spec.constant];
+    constraint.priority = spec.priority;
+    return constraint;
+}
+
 void BuildLineWithSpacing(NSArray *views, NSLayoutFormatOptions alignment, NSString *spacing, NSUInteger priority)
 {
-    if (!views.count)
+    CONSTRAINT_PROBE();
+    if (views.count < 2)
         return;
     
-    VIEW_CLASS *view1, *view2;
     NSInteger axis = IS_HORIZONTAL_ALIGNMENT(alignment);
     NSString *axisString = (axis == 0) ? @"H:" : @"V:";
     
-    NSString *format = [NSString stringWithFormat:@"%@[view1]%@[view2]", axisString, spacing];
+    VFLParseResult spacings;
+    if (!ParseLineSpacing(axisString, spacing, &spacings))
+        return;
     
-    for (int i = 1; i < views.count; i++)
+    // Every neighboring pair repeats the same specs
+    NSMutableArray *constraints = [NSMutableArray arrayWithCapacity:(views.count - 1) * spacings.specCount];
+    VIEW_CLASS *view1 = views[0];
+    for (NSUInteger i = 1; i < views.count; i++)
     {
-        view1 = views[i-1];
-        view2 = views[i];
-        NSDictionary *bindings = NSDictionaryOfVariableBindings(view1, view2);
-        NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:format options:0 metrics:nil views:bindings];
-        InstallConstraints(constraints, priority, @"Build Line");
+        VIEW_CLASS *view2 = views[i];
+        for (size_t j = 0; j < spacings.specCount; j++)
+            [constraints addObject:ConstraintForLineSpec(spacings.specs[j], view1, view2)];
+        view1 = view2;
     }
+    VFLParseResultRelease(&spacings);
+    
+    InstallConstraints(constraints, priority, @"Build Line");
 }
 
 void BuildLine(NSArray *views, NSLayoutFormatOptions alignment, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     BuildLineWithSpacing(views, alignment, @"-", priority);
 }
 
 void PseudoDistributeCenters(NSArray *views, NSLayoutFormatOptions alignment, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     if (!views.count)
         return;
     
@@ -260,47 +465,62 @@ void PseudoDistributeCenters(NSArray *views, NSLayoutFormatOptions alignment, NS
 
 void PseudoDistributeWithSpacers(VIEW_CLASS *superview, NSArray *views, NSLayoutFormatOptions alignment, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     // You pin the first and last items wherever you want
     
     // Must pass views, superview, non-zero alignment
-    if (!views.count) return;
+    if (views.count < 2) return;
     if (!superview) return;
     if (alignment == 0) return;
     
-    // Build disposable spacers
-    NSMutableArray *spacers = [NSMutableArray array];
-    for (int i = 0; i < views.count; i++)
-    {
-        [spacers addObject:[[VIEW_CLASS alloc] init]];
-        [spacers[i] setTranslatesAutoresizingMaskIntoConstraints:NO];
-        [superview addSubview:spacers[i]];
-    }
+    // Build disposable spacers, one per gap. Guides have no
+    // baseline, so baseline alignment falls back to spacer views
+    BOOL allowGuides = !(alignment & NSLayoutFormatAlignAllBaseline);
+    NSMutableArray *spacers = [NSMutableArray arrayWithCapacity:views.count - 1];
+    for (NSUInteger i = 1; i < views.count; i++)
+        [spacers addObject:AddSpacer(superview, @"PseudoDistribution Spacer", allowGuides)];
     
+    // The line runs orthogonal to the alignment
     BOOL horizontal = IS_HORIZONTAL_ALIGNMENT(alignment);
-    VIEW_CLASS *firstspacer = spacers[0];
+    NSLayoutAttribute leading = horizontal ? NSLayoutAttributeTop : NSLayoutAttributeLeading;
+    NSLayoutAttribute trailing = horizontal ? NSLayoutAttributeBottom : NSLayoutAttributeTrailing;
+    NSLayoutAttribute size = horizontal ? NSLayoutAttributeHeight : NSLayoutAttributeWidth;
     
-    // No sizing restriction between views
-    NSString *format = [NSString stringWithFormat:@"%@:[view1][spacer(==firstspacer)][view2]", horizontal ? @"V" : @"H"];
+    // Each AlignAll option is 1 << its attribute
+    NSLayoutAttribute alignments[NSLayoutAttributeBaseline + 1];
+    NSUInteger alignmentCount = 0;
+    for (NSLayoutAttribute attribute = NSLayoutAttributeLeft; attribute <= NSLayoutAttributeBaseline; attribute++)
+        if (alignment & (1 << attribute))
+            alignments[alignmentCount++] = attribute;
     
-    // Equal sizing restriction
-    // NSString *format = [NSString stringWithFormat:@"%@:[view1][spacer(==firstspacer)][view2(==view1)]", horizontal ? @"V" : @"H"];
-    
-    // Lay out the row or column
-    for (int i = 1; i < views.count; i++)
+    // [view1][spacer(==firstspacer)][view2] for each pair, as one batch
+    id firstspacer = spacers[0];
+    NSMutableArray *constraints = [NSMutableArray arrayWithCapacity:(views.count - 1) * (3 + 2 * alignmentCount)];
+    for (NSUInteger i = 1; i < views.count; i++)
     {
-        VIEW_CLASS *view1 = views[i-1];
+        VIEW_CLASS *view1 = views[i - 1];
         VIEW_CLASS *view2 = views[i];
-        VIEW_CLASS *spacer = spacers[i-1];
+        id spacer = spacers[i - 1];
         
-        NSDictionary *bindings = NSDictionaryOfVariableBindings(view1, view2, spacer, firstspacer);
+        [constraints addObject:[NSLayoutConstraint constraintWithItem:spacer attribute:leading relatedBy:NSLayoutRelationEqual toItem:view1 attribute:trailing multiplier:1 constant:0]];
+        [constraints addObject:[NSLayoutConstraint constraintWithItem:view2 attribute:leading relatedBy:NSLayoutRelationEqual toItem:spacer attribute:trailing multiplier:1 constant:0]];
+        if (spacer != firstspacer)
+            [constraints addObject:[NSLayoutConstraint constraintWithItem:spacer attribute:size relatedBy:NSLayoutRelationEqual toItem:firstspacer attribute:size multiplier:1 constant:0]];
         
-        NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:format options:alignment metrics:nil views:bindings];
-        InstallConstraints(constraints, priority, @"PseudoDistribution");
+        for (NSUInteger j = 0; j < alignmentCount; j++)
+        {
+            [constraints addObject:[NSLayoutConstraint constraintWithItem:spacer attribute:alignments[j] relatedBy:NSLayoutRelationEqual toItem:view1 attribute:alignments[j] multiplier:1 constant:0]];
+            [constraints addObject:[NSLayoutConstraint constraintWithItem:view2 attribute:alignments[j] relatedBy:NSLayoutRelationEqual toItem:spacer attribute:alignments[j] multiplier:1 constant:0]];
+        }
     }
+    
+    [RecordForView(superview, YES).constraints addObjectsFromArray:constraints];
+    InstallConstraints(constraints, priority, @"PseudoDistribution");
 }
 
-// Create equal-sized spacers to float the view horizontally
-void FloatViewsH(VIEW_CLASS *firstView, VIEW_CLASS *lastView, NSUInteger priority)
+// Equal-sized spacers at either end float the views. The spacers'
+// 40-point cross size, at priority 1, assists with debugging
+void _FloatViews(VIEW_CLASS *firstView, VIEW_CLASS *lastView, BOOL horizontal, NSUInteger priority)
 {
     if (!firstView.superview) return;
     if (!lastView.superview) return;
@@ -309,88 +529,128 @@ void FloatViewsH(VIEW_CLASS *firstView, VIEW_CLASS *lastView, NSUInteger priorit
     if (!nca) return;
     if (nca == firstView)
         nca = firstView.superview;
-
+    
     // Create and install spacers
-    VIEW_CLASS *spacer1 = [[VIEW_CLASS alloc] init];
-    VIEW_CLASS *spacer2 = [[VIEW_CLASS alloc] init];
-    [nca addSubview:spacer1];
-    [nca addSubview:spacer2];
-    PREPCONSTRAINTS(spacer1);
-    PREPCONSTRAINTS(spacer2);
-
-    // To assist with debugging, this gives the spacer a height of 40
-    for (VIEW_CLASS *view in @[spacer1, spacer2])
+    NSString *nametag = horizontal ? @"SpacerH" : @"SpacerV";
+    id spacer1 = AddSpacer(nca, nametag, YES);
+    id spacer2 = AddSpacer(nca, nametag, YES);
+    
+    NSLayoutAttribute leading = horizontal ? NSLayoutAttributeLeading : NSLayoutAttributeTop;
+    NSLayoutAttribute trailing = horizontal ? NSLayoutAttributeTrailing : NSLayoutAttributeBottom;
+    NSLayoutAttribute size = horizontal ? NSLayoutAttributeWidth : NSLayoutAttributeHeight;
+    NSLayoutAttribute crossSize = horizontal ? NSLayoutAttributeHeight : NSLayoutAttributeWidth;
+    
+    NSMutableArray *constraints = [NSMutableArray arrayWithCapacity:7];
+    
+    // Spacers flush against the views, hugging the edges, matching sizes
+    [constraints addObject:[NSLayoutConstraint constraintWithItem:firstView attribute:leading relatedBy:NSLayoutRelationEqual toItem:spacer1 attribute:trailing multiplier:1 constant:0]];
+    [constraints addObject:[NSLayoutConstraint constraintWithItem:spacer2 attribute:leading relatedBy:NSLayoutRelationEqual toItem:lastView attribute:trailing multiplier:1 constant:0]];
+    [constraints addObject:[NSLayoutConstraint constraintWithItem:spacer1 attribute:leading relatedBy:NSLayoutRelationEqual toItem:nca attribute:leading multiplier:1 constant:0]];
+    [constraints addObject:[NSLayoutConstraint constraintWithItem:spacer2 attribute:trailing relatedBy:NSLayoutRelationEqual toItem:nca attribute:trailing multiplier:1 constant:0]];
+    [constraints addObject:[NSLayoutConstraint constraintWithItem:spacer1 attribute:size relatedBy:NSLayoutRelationEqual toItem:spacer2 attribute:size multiplier:1 constant:0]];
+    if (priority)
+        for (NSLayoutConstraint *constraint in constraints)
+            constraint.priority = priority;
+    
+    for (id spacer in @[spacer1, spacer2])
     {
-        view.nametag = @"SpacerH";
-        InstallConstraints([NSLayoutConstraint constraintsWithVisualFormat:@"V:[view(==40)]" options:0 metrics:nil views:NSDictionaryOfVariableBindings(view)], 1, nil);
+        NSLayoutConstraint *constraint = [NSLayoutConstraint constraintWithItem:spacer attribute:crossSize relatedBy:NSLayoutRelationEqual toItem:nil attribute:NSLayoutAttributeNotAnAttribute multiplier:1 constant:40];
+        constraint.priority = 1;
+        [constraints addObject:constraint];
     }
     
-    // Add spacers to left and right
-    BuildLineWithSpacing(@[spacer1, firstView], NSLayoutFormatAlignAllCenterY, @"", priority);
-    BuildLineWithSpacing(@[lastView, spacer2], NSLayoutFormatAlignAllCenterY, @"", priority);
-   
-    // Hug edges, match sizes
-    AlignView(spacer1, NSLayoutAttributeLeading, 0, priority);
-    AlignView(spacer2, NSLayoutAttributeTrailing, 0, priority);
-    MatchSizeH(spacer1, spacer2, priority);
+    [RecordForView(nca, YES).constraints addObjectsFromArray:constraints];
+    InstallConstraints(constraints, 0, @"Float Views");
+}
+
+void FloatViewsH(VIEW_CLASS *firstView, VIEW_CLASS *lastView, NSUInteger priority)
+{
+    CONSTRAINT_PROBE();
+    _FloatViews(firstView, lastView, YES, priority);
 }
 
-// Create equal-sized spacers to float the view vertically
 void FloatViewsV(VIEW_CLASS *firstView, VIEW_CLASS *lastView, NSUInteger priority)
 {
-    if (!firstView.superview) return;
-    if (!lastView.superview) return;
-    
-    VIEW_CLASS *nca = [firstView nearestCommonAncestorToView:lastView];
-    if (!nca) return;
-    if (nca == firstView)
-        nca = firstView.superview;
+    CONSTRAINT_PROBE();
+    _FloatViews(firstView, lastView, NO, priority);
+}
+
+#pragma mark - Grids
+
+// One pass, adjacency only: each view relates to the view before it
+// in its row and the view above it in its column
+NSUInteger BuildGrid(NSArray *views, NSUInteger columns, CGFloat rowSpacing, CGFloat columnSpacing, NSLayoutFormatOptions alignment, NSUInteger priority)
+{
+    CONSTRAINT_PROBE();
+    if (!views.count || !columns)
+        return 0;
     
-    // Create and install spacers
-    VIEW_CLASS *spacer1 = [[VIEW_CLASS alloc] init];
-    VIEW_CLASS *spacer2 = [[VIEW_CLASS alloc] init];
-    [nca addSubview:spacer1];
-    [nca addSubview:spacer2];
-    PREPCONSTRAINTS(spacer1);
-    PREPCONSTRAINTS(spacer2);
-    
-    // To assist with debugging, this gives the spacer a width of 40
-    for (VIEW_CLASS *view in @[spacer1, spacer2])
+    NSLayoutAttribute rowAttribute = alignment ? AttributeForAlignment(alignment) : NSLayoutAttributeCenterY;
+    if (!IS_VERTICAL_ATTRIBUTE(rowAttribute))
     {
-        InstallConstraints([NSLayoutConstraint constraintsWithVisualFormat:@"H:[view(==40)]" options:0 metrics:nil views:NSDictionaryOfVariableBindings(view)], 1, nil);
-        view.nametag = @"SpacerV";
+        NSLog(@"Error: Grid rows align on one of top, centerY, bottom or baseline");
+        return 0;
     }
     
-    // Add spacers to top and bottom
-    BuildLineWithSpacing(@[spacer1, firstView], NSLayoutFormatAlignAllCenterX, @"", priority);
-    BuildLineWithSpacing(@[lastView, spacer2], NSLayoutFormatAlignAllCenterX, @"", priority);
+    NSUInteger count = views.count;
+    NSMutableArray *constraints = [NSMutableArray arrayWithCapacity:3 * count];
+    for (NSUInteger i = 0; i < count; i++)
+    {
+        VIEW_CLASS *view = views[i];
+        NSUInteger column = i % columns;
+        BOOL lastInRow = (column == columns - 1) || (i == count - 1);
+        
+        // Row chain: spaced, aligned and, in the first row, equally wide
+        if (column > 0)
+        {
+            VIEW_CLASS *previous = views[i - 1];
+            [constraints addObject:[NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeLeading relatedBy:NSLayoutRelationEqual toItem:previous attribute:NSLayoutAttributeTrailing multiplier:1 constant:columnSpacing]];
+            [constraints addObject:[NSLayoutConstraint constraintWithItem:view attribute:rowAttribute relatedBy:NSLayoutRelationEqual toItem:previous attribute:rowAttribute multiplier:1 constant:0]];
+            if (i < columns)
+                [constraints addObject:[NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeWidth relatedBy:NSLayoutRelationEqual toItem:previous attribute:NSLayoutAttributeWidth multiplier:1 constant:0]];
+        }
+        
+        // Column: share the leading edge with the view above. With the
+        // row chains, that fixes every width but the last in each row
+        if (i >= columns)
+        {
+            VIEW_CLASS *above = views[i - columns];
+            [constraints addObject:[NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeLeading relatedBy:NSLayoutRelationEqual toItem:above attribute:NSLayoutAttributeLeading multiplier:1 constant:0]];
+            if (column == 0)
+                [constraints addObject:[NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeTop relatedBy:NSLayoutRelationEqual toItem:above attribute:NSLayoutAttributeBottom multiplier:1 constant:rowSpacing]];
+            if (lastInRow)
+                [constraints addObject:[NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeWidth relatedBy:NSLayoutRelationEqual toItem:above attribute:NSLayoutAttributeWidth multiplier:1 constant:0]];
+        }
+    }
     
-    // Hug edges, match sizes
-    AlignView(spacer1, NSLayoutAttributeTop, 0, priority);
-    AlignView(spacer2, NSLayoutAttributeBottom, 0, priority);
-    MatchSizeV(spacer1, spacer2, priority);
+    InstallConstraints(constraints, priority, @"Build Grid");
+    return constraints.count;
 }
 
 #pragma mark - Alignment
 void AlignView(VIEW_CLASS *view, NSLayoutAttribute attribute, NSInteger inset, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     NSLayoutConstraint *constraint = [NSLayoutConstraint constraintWithItem:view attribute:attribute relatedBy:NSLayoutRelationEqual toItem:view.superview attribute:attribute multiplier:1 constant:inset];
     [constraint install:priority];
 }
 
 void CenterView(VIEW_CLASS *view, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     AlignView(view, NSLayoutAttributeCenterX, 0, priority);
     AlignView(view, NSLayoutAttributeCenterY, 0, priority);
 }
 
 void CenterViewH(VIEW_CLASS *view, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     AlignView(view, NSLayoutAttributeCenterX, 0, priority);
 }
 
 void CenterViewV(VIEW_CLASS *view, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     AlignView(view, NSLayoutAttributeCenterY, 0, priority);
 }
 
@@ -401,18 +661,21 @@ void CenterViewV(VIEW_CLASS *view, NSUInteger priority)
 // An exact position will not be overriden by internationalization
 NSLayoutConstraint *ConstraintPositioningViewH(VIEW_CLASS *view, CGFloat x)
 {
+    CONSTRAINT_PROBE();
     NSLayoutConstraint *constraint = [NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeLeft relatedBy:NSLayoutRelationEqual toItem:view.superview attribute:NSLayoutAttributeLeft multiplier:1 constant:x];
     return constraint;
 }
 
 NSLayoutConstraint *ConstraintPositioningViewV(VIEW_CLASS *view, CGFloat y)
 {
+    CONSTRAINT_PROBE();
     NSLayoutConstraint *constraint = [NSLayoutConstraint constraintWithItem:view attribute:NSLayoutAttributeTop relatedBy:NSLayoutRelationEqual toItem:view.superview attribute:NSLayoutAttributeTop multiplier:1 constant:y];
     return constraint;
 }
 
 NSArray *ConstraintsPositioningView(VIEW_CLASS *view, CGPoint point)
 {
+    CONSTRAINT_PROBE();
     return @[
              ConstraintPositioningViewH(view, point.x),
              ConstraintPositioningViewV(view, point.y),
@@ -421,19 +684,22 @@ NSArray *ConstraintsPositioningView(VIEW_CLASS *view, CGPoint point)
 
 void PositionView(VIEW_CLASS *view, CGPoint point, NSUInteger priority)
 {
+    CONSTRAINT_PROBE();
     NSArray *constraints = ConstraintsPositioningView(view, point);
     InstallConstraints(constraints, priority, @"Position");
 }
 
 void Pin(VIEW_CLASS *view, NSString *format)
 {
-    NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:format options:0 metrics:nil views:@{@"view":view}];
+    CONSTRAINT_PROBE();
+    NSArray *constraints = TemplateConstraints(format, 0, nil, @{@"view":view});
     InstallConstraints(constraints, LayoutPriorityRequired, nil);
 }
 
 void PinWithPriority(VIEW_CLASS *view, NSString *format, NSString *name, int priority)
 {
-    NSArray *constraints = [NSLayoutConstraint constraintsWithVisualFormat:format options:0 metrics:nil views:@{@"view":view}];
+    CONSTRAINT_PROBE();
+    NSArray *constraints = TemplateConstraints(format, 0, nil, @{@"view":view});
     InstallConstraints(constraints, priority, name);
 }
 
@@ -441,6 +707,7 @@ void PinWithPriority(VIEW_CLASS *view, NSString *format, NSString *name, int pri
 
 void LoadContrastViewsOntoView(VIEW_CLASS *aView)
 {
+    CONSTRAINT_PROBE();
     // Create a pair of contrast views to highlight placement
     VIEW_CLASS *contrastView;
     COLOR_CLASS *bgColor = [[COLOR_CLASS lightGrayColor] colorWithAlphaComponent:0.3f];
@@ -11,20 +11,22 @@
 #endif
 
 #import "ConstraintUtilities+Install.h"
+#import "ConstraintUtilities+Index.h"
 #import "NametagUtilities.h"
+#import "ConstraintUtilities+Traits.h"
 
 #pragma mark - Testing Constraint Elements
 
-#define IS_SIZE_ATTRIBUTE(ATTRIBUTE) [@[@(NSLayoutAttributeWidth), @(NSLayoutAttributeHeight)] containsObject:@(ATTRIBUTE)]
-#define IS_CENTER_ATTRIBUTE(ATTRIBUTE) [@[@(NSLayoutAttributeCenterX), @(NSLayoutAttributeCenterY)] containsObject:@(ATTRIBUTE)]
-#define IS_EDGE_ATTRIBUTE(ATTRIBUTE) [@[@(NSLayoutAttributeLeft), @(NSLayoutAttributeRight), @(NSLayoutAttributeTop), @(NSLayoutAttributeBottom), @(NSLayoutAttributeLeading), @(NSLayoutAttributeTrailing), @(NSLayoutAttributeBaseline)] containsObject:@(ATTRIBUTE)]
+#define IS_SIZE_ATTRIBUTE(ATTRIBUTE) ConstraintAttributeHasTrait(ATTRIBUTE, ConstraintTraitSize)
+#define IS_CENTER_ATTRIBUTE(ATTRIBUTE) ConstraintAttributeHasTrait(ATTRIBUTE, ConstraintTraitCenter)
+#define IS_EDGE_ATTRIBUTE(ATTRIBUTE) ConstraintAttributeHasTrait(ATTRIBUTE, ConstraintTraitEdge)
 #define IS_LOCATION_ATTRIBUTE(ATTRIBUTE) (IS_EDGE_ATTRIBUTE(ATTRIBUTE) || IS_CENTER_ATTRIBUTE(ATTRIBUTE))
 
-#define IS_HORIZONTAL_ATTRIBUTE(ATTRIBUTE) [@[@(NSLayoutAttributeLeft), @(NSLayoutAttributeRight), @(NSLayoutAttributeLeading), @(NSLayoutAttributeTrailing), @(NSLayoutAttributeCenterX), @(NSLayoutAttributeWidth)] containsObject:@(ATTRIBUTE)]
-#define IS_VERTICAL_ATTRIBUTE(ATTRIBUTE) [@[@(NSLayoutAttributeTop), @(NSLayoutAttributeBottom), @(NSLayoutAttributeCenterY), @(NSLayoutAttributeHeight), @(NSLayoutAttributeBaseline)] containsObject:@(ATTRIBUTE)]
+#define IS_HORIZONTAL_ATTRIBUTE(ATTRIBUTE) ConstraintAttributeHasTrait(ATTRIBUTE, ConstraintTraitHorizontal)
+#define IS_VERTICAL_ATTRIBUTE(ATTRIBUTE) ConstraintAttributeHasTrait(ATTRIBUTE, ConstraintTraitVertical)
 
-#define IS_HORIZONTAL_ALIGNMENT(ALIGNMENT) [@[@(NSLayoutFormatAlignAllLeft), @(NSLayoutFormatAlignAllRight), @(NSLayoutFormatAlignAllLeading), @(NSLayoutFormatAlignAllTrailing), @(NSLayoutFormatAlignAllCenterX), ] containsObject:@(ALIGNMENT)]
-#define IS_VERTICAL_ALIGNMENT(ALIGNMENT) [@[@(NSLayoutFormatAlignAllTop), @(NSLayoutFormatAlignAllBottom), @(NSLayoutFormatAlignAllCenterY), @(NSLayoutFormatAlignAllBaseline), ] containsObject:@(ALIGNMENT)]
+#define IS_HORIZONTAL_ALIGNMENT(ALIGNMENT) ConstraintAlignmentHasTrait(ALIGNMENT, ConstraintTraitHorizontal)
+#define IS_VERTICAL_ALIGNMENT(ALIGNMENT) ConstraintAlignmentHasTrait(ALIGNMENT, ConstraintTraitVertical)
 
 // If you use in production code, please make sure to add
 // namespace indicators to class category methods
@@ -46,6 +48,9 @@
 // Multiple
 - (NSArray *) constraintsNamed: (NSString *) aName;
 - (NSArray *) constraintsNamed: (NSString *) aName matchingView: (VIEW_CLASS *) view;
+
+// Memoized until the window's generation changes
+- (NSLayoutConstraint *) cachedConstraintNamed: (NSString *) aName;
 @end
 
 /*
@@ -55,10 +60,24 @@
  and want to remove their equivalents from another view.
  */
 
+#pragma mark - Constraint Signatures
+
+// A 64-bit digest of items, attributes, relation, multiplier and
+// constant, and optionally priority. Equal constraints always share
+// a signature. Distinct ones rarely collide, so confirm with
+// isEqualToLayoutConstraint: before acting on a match
+typedef uint64_t ConstraintSignature;
+ConstraintSignature ConstraintSignatureFor(NSLayoutConstraint *constraint, BOOL includePriority);
+
+// The same, leaving out constant and priority: the parts
+// that can change while a constraint stays installed
+ConstraintSignature ConstraintShapeSignatureFor(NSLayoutConstraint *constraint);
+
 #pragma mark - Constraint Matching
 @interface NSLayoutConstraint (ConstraintMatching)
 - (BOOL) isEqualToLayoutConstraint: (NSLayoutConstraint *) constraint;
 - (BOOL) isEqualToLayoutConstraintConsideringPriority: (NSLayoutConstraint *) constraint;
+@property (nonatomic, readonly) NSUInteger layoutHash; // agrees with isEqualToLayoutConstraint:
 - (BOOL) refersToView: (VIEW_CLASS *) aView;
 @property (nonatomic, readonly) BOOL isHorizontal;
 @end
@@ -68,6 +87,7 @@
 @property (nonatomic, readonly) NSArray *allConstraints;
 @property (nonatomic, readonly) NSArray *referencingConstraintsInSuperviews;
 @property (nonatomic, readonly) NSArray *referencingConstraints;
+@property (nonatomic, readonly) NSArray *cachedReferencingConstraints; // memoized by generation
 
 // Retrieving constraints
 - (NSLayoutConstraint *) constraintMatchingConstraint: (NSLayoutConstraint *) aConstraint;
@@ -86,6 +106,27 @@
 - (void) removeConstraintsNamed: (NSString *) name;
 - (void) removeConstraintsNamed: (NSString *) name matchingView: (VIEW_CLASS *) view;
 
+// Remove constraints carrying any of the names, held by self or a
+// descendant, plus those held by superviews that tie a subtree view
+// to the outside. One pass down, one removeConstraints: per owner.
+// Returns the number removed; removed, if given, receives them for
+// a later reinstall
+- (NSUInteger) removeSubtreeConstraintsNamed: (NSString *) name;
+- (NSUInteger) removeSubtreeConstraintsWithNames: (NSArray *) names removed: (NSArray **) removed;
+
+// Tearing down: remove every constraint the pack installed inside
+// the subtree or above it mentioning a subtree view. IB and system
+// constraints are left alone. One pass, one removeConstraints: per
+// owner. Returns the number removed
+- (NSUInteger) removeConstraintsReferencingSubtree;
+
+// Exact-class NSLayoutConstraints held by self, by the axis and kind
+// of their first attribute. Content size and autoresizing constraints
+// are not bucketed; widthConstraints and heightConstraints still scan
+// everything. The block form visits the bucket without copying
+- (void) enumerateConstraintsAffectingAxis: (ConstraintAxis) axis kind: (ConstraintKind) kind usingBlock: (ConstraintEnumerationBlock) block;
+- (NSArray *) constraintsAffectingAxis: (ConstraintAxis) axis kind: (ConstraintKind) kind;
+
 // Kicking the ball around a bit here
 @property (nonatomic, readonly) NSArray *widthConstraints;
 @property (nonatomic, readonly) NSArray *heightConstraints;
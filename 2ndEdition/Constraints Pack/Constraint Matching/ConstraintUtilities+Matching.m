@@ -6,6 +6,8 @@
 
 #import "ConstraintUtilities+Matching.h"
 #import "NametagUtilities.h"
+#import "ConstraintUtilities+Index.h"
+#import "ConstraintUtilities+Instrumentation.h"
 
 #pragma mark - Named Constraint Support
 @implementation VIEW_CLASS (NamedConstraintSupport)
@@ -14,85 +16,147 @@
 // Type not checked
 - (NSLayoutConstraint *) constraintNamed: (NSString *) aName
 {
+    CONSTRAINT_PROBE();
     if (!aName) return nil;
-    for (NSLayoutConstraint *constraint in self.constraints)
-        if (constraint.nametag && [constraint.nametag isEqualToString:aName])
-            return constraint;
-
-    // Recurse up the tree
-    if (self.superview)
-        return [self.superview constraintNamed:aName];
-
-    return nil;
+    
+    // Nearest owner first, as when walking up the tree
+    return [IndexedConstraintsNamed(aName, nil, self, 1) firstObject];
 }
 
 // Returns first constraint with matching name and view.
 // Type not checked
 - (NSLayoutConstraint *) constraintNamed: (NSString *) aName matchingView: (VIEW_CLASS *) theView
 {
+    CONSTRAINT_PROBE();
     if (!aName) return nil;
+    if (!theView) return nil;
     
-    for (NSLayoutConstraint *constraint in self.constraints)
-        if (constraint.nametag && [constraint.nametag isEqualToString:aName])
-        {
-            if (constraint.firstItem == theView)
-                return constraint;
-            if (constraint.secondItem && (constraint.secondItem == theView))
-                return constraint;
-        }
-    
-    // Recurse up the tree
-    if (self.superview)
-        return [self.superview constraintNamed:aName matchingView:theView];
-    
-    return nil;
+    return [IndexedConstraintsNamed(aName, theView, self, 1) firstObject];
 }
 
 // Returns all matching constraints
 // Type not checked
 - (NSArray *) constraintsNamed: (NSString *) aName
 {
+    CONSTRAINT_PROBE();
     // For this, all constraints match a nil item
     if (!aName) return self.constraints;
     
     // However, constraints have to have a name to match a non-nil name
-    NSMutableArray *array = [NSMutableArray array];
-    for (NSLayoutConstraint *constraint in self.constraints)
-        if (constraint.nametag && [constraint.nametag isEqualToString:aName])
-            [array addObject:constraint];
-    
-    // recurse upwards
-    if (self.superview)
-        [array addObjectsFromArray:[self.superview constraintsNamed:aName]];
-    
-    return array;
+    return IndexedConstraintsNamed(aName, nil, self, 0);
 }
 
 // Returns all matching constraints specific to a given view
 // Type not checked
 - (NSArray *) constraintsNamed: (NSString *) aName matchingView: (VIEW_CLASS *) theView
 {
+    CONSTRAINT_PROBE();
     // For this, all constraints match a nil item
     if (!aName) return self.constraints;
+    if (!theView) return @[];
     
-    // However, constraints have to have a name to match a non-nil name
-    NSMutableArray *array = [NSMutableArray array];
-    for (NSLayoutConstraint *constraint in self.constraints)
-        if (constraint.nametag && [constraint.nametag isEqualToString:aName])
+    return IndexedConstraintsNamed(aName, theView, self, 0);
+}
+
+// Repeat lookups in an unchanged window skip the index
+- (NSLayoutConstraint *) cachedConstraintNamed: (NSString *) aName
+{
+    CONSTRAINT_PROBE();
+    if (!aName) return nil;
+    return MemoizedViewQuery(self, @"constraintNamed:", aName, ^id{
+        return [self constraintNamed:aName];
+    });
+}
+@end
+
+#pragma mark - Constraint Signatures
+
+static inline uint64_t SignatureMix(uint64_t hash, uint64_t value)
+{
+    return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+// Compare as == does: -0 and +0 hash alike
+static inline uint64_t SignatureBits(double value)
+{
+    if (value == 0) value = 0;
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static ConstraintSignature SignatureOf(NSLayoutConstraint *constraint, BOOL includeConstant, BOOL includePriority)
+{
+    uint64_t hash = 0;
+    hash = SignatureMix(hash, (uintptr_t) (__bridge void *) constraint.firstItem);
+    hash = SignatureMix(hash, (uintptr_t) (__bridge void *) constraint.secondItem);
+    hash = SignatureMix(hash, (uint64_t) constraint.firstAttribute);
+    hash = SignatureMix(hash, (uint64_t) constraint.secondAttribute << 8 | (uint64_t) (constraint.relation + 1));
+    hash = SignatureMix(hash, SignatureBits(constraint.multiplier));
+    if (includeConstant)
+        hash = SignatureMix(hash, SignatureBits(constraint.constant));
+    if (includePriority)
+        hash = SignatureMix(hash, SignatureBits(constraint.priority));
+    
+    // Finish with the splitmix64 finalizer so every input bit
+    // reaches the low bits used for bucketing
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+ConstraintSignature ConstraintSignatureFor(NSLayoutConstraint *constraint, BOOL includePriority)
+{
+    return SignatureOf(constraint, YES, includePriority);
+}
+
+ConstraintSignature ConstraintShapeSignatureFor(NSLayoutConstraint *constraint)
+{
+    return SignatureOf(constraint, NO, NO);
+}
+
+// Installed NSLayoutConstraints from start upwards, bucketed by
+// signature. Each bucket keeps nearest-first order
+static NSMutableDictionary *SignatureTableForAscent(VIEW_CLASS *start)
+{
+    NSMutableDictionary *table = [NSMutableDictionary dictionary];
+    for (VIEW_CLASS *view = start; view != nil; view = view.superview)
+        for (NSLayoutConstraint *constraint in view.constraints)
         {
-            if (constraint.firstItem == theView)
-                [array addObject:constraint];
-            else if (constraint.secondItem && (constraint.secondItem == theView))
-                [array addObject:constraint];
+            if (![constraint.class isEqual:[NSLayoutConstraint class]])
+                continue;
+            
+            NSNumber *key = @(ConstraintSignatureFor(constraint, NO));
+            NSMutableArray *bucket = table[key];
+            if (!bucket)
+            {
+                bucket = [NSMutableArray array];
+                table[key] = bucket;
+            }
+            [bucket addObject:constraint];
         }
-    
-    // recurse upwards
-    if (self.superview)
-        [array addObjectsFromArray:[self.superview constraintsNamed:aName matchingView:theView]];
+    return table;
+}
 
-    return array;
+// Consuming a match lets repeated inputs find successive installed copies
+static NSLayoutConstraint *MatchFromSignatureTable(NSDictionary *table, NSLayoutConstraint *aConstraint, BOOL consume)
+{
+    NSMutableArray *bucket = table[@(ConstraintSignatureFor(aConstraint, NO))];
+    for (NSUInteger i = 0; i < bucket.count; i++)
+    {
+        NSLayoutConstraint *constraint = bucket[i];
+        if (![constraint isEqualToLayoutConstraint:aConstraint])
+            continue;
+        
+        if (consume)
+            [bucket removeObjectAtIndex:i];
+        return constraint;
+    }
+    return nil;
 }
-@end
 
 #pragma mark - Constraint Matching
 @implementation NSLayoutConstraint (ConstraintMatching)
@@ -100,6 +164,7 @@
 // This ignores any priority, looking only at y (R) mx + b
 - (BOOL) isEqualToLayoutConstraint: (NSLayoutConstraint *) constraint
 {
+    CONSTRAINT_PROBE();
     // I'm still wavering on these two checks
     if (![self.class isEqual:[NSLayoutConstraint class]]) return NO;
     if (![self.class isEqual:constraint.class]) return NO;
@@ -119,14 +184,21 @@
 // This looks at priority too
 - (BOOL) isEqualToLayoutConstraintConsideringPriority:(NSLayoutConstraint *)constraint
 {
+    CONSTRAINT_PROBE();
     if (![self isEqualToLayoutConstraint:constraint])
         return NO;
     
     return (self.priority == constraint.priority);
 }
 
+- (NSUInteger) layoutHash
+{
+    return (NSUInteger) ConstraintSignatureFor(self, NO);
+}
+
 - (BOOL) refersToView: (VIEW_CLASS *) theView
 {
+    CONSTRAINT_PROBE();
     if (!theView)
         return NO;
     if (!self.firstItem) // shouldn't happen. Illegal
@@ -140,6 +212,7 @@
 
 - (BOOL) isHorizontal
 {
+    CONSTRAINT_PROBE();
     return IS_HORIZONTAL_ATTRIBUTE(self.firstAttribute);
 }
 @end
@@ -150,8 +223,8 @@
 // Find first matching constraint. (Priority, Archiving ignored)
 - (NSLayoutConstraint *) constraintMatchingConstraint: (NSLayoutConstraint *) aConstraint
 {
-    NSArray *views = [@[self] arrayByAddingObjectsFromArray:self.superviews];
-    for (VIEW_CLASS *view in views)
+    CONSTRAINT_PROBE();
+    for (VIEW_CLASS *view = self; view != nil; view = view.superview)
         for (NSLayoutConstraint *constraint in view.constraints)
             if ([constraint isEqualToLayoutConstraint:aConstraint])
                 return constraint;
@@ -164,54 +237,48 @@
 // Call on self.window for the entire collection
 - (NSArray *) allConstraints
 {
+    CONSTRAINT_PROBE();
     NSMutableArray *array = [NSMutableArray array];
-    [array addObjectsFromArray:self.constraints];
-    for (VIEW_CLASS *view in self.subviews)
-        [array addObjectsFromArray:[view allConstraints]];
+    [self enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        [array addObjectsFromArray:view.constraints];
+    }];
     return array;
 }
 
 // Ancestor constraints pointing to self
+// Served from the constraint index
 - (NSArray *) referencingConstraintsInSuperviews
 {
-    NSMutableArray *array = [NSMutableArray array];
-    for (VIEW_CLASS *view in self.superviews)
-    {
-        for (NSLayoutConstraint *constraint in view.constraints)
-        {
-            if (![constraint.class isEqual:[NSLayoutConstraint class]])
-                continue;
-            
-            if ([constraint refersToView:self])
-                [array addObject:constraint];
-        }
-    }
-    return array;
+    CONSTRAINT_PROBE();
+    return IndexedConstraintsReferencingView(self, self.superview);
 }
 
 // Ancestor *and* self constraints pointing to self
 - (NSArray *) referencingConstraints
 {
-    NSMutableArray *array = [self.referencingConstraintsInSuperviews mutableCopy];
-    for (NSLayoutConstraint *constraint in self.constraints)
-    {
-        if (![constraint.class isEqual:[NSLayoutConstraint class]])
-            continue;
-        
-        if ([constraint refersToView:self])
-            [array addObject:constraint];
-    }
-    return array;
+    CONSTRAINT_PROBE();
+    return IndexedConstraintsReferencingView(self, self);
+}
+
+- (NSArray *) cachedReferencingConstraints
+{
+    CONSTRAINT_PROBE();
+    return MemoizedViewQuery(self, @"referencingConstraints", nil, ^id{
+        return self.referencingConstraints;
+    });
 }
 
 // Find all matching constraints. (Priority, archiving ignored)
 // Use with arrays returned by format strings to find installed versions
 - (NSArray *) constraintsMatchingConstraints: (NSArray *) constraints
 {
+    CONSTRAINT_PROBE();
+    // One pass over the ascent, then one lookup per input
     NSMutableArray *array = [NSMutableArray array];
+    NSDictionary *table = SignatureTableForAscent(self);
     for (NSLayoutConstraint *constraint in constraints)
     {
-        NSLayoutConstraint *match = [self constraintMatchingConstraint:constraint];
+        NSLayoutConstraint *match = MatchFromSignatureTable(table, constraint, NO);
         if (match)
             [array addObject:match];
     }
@@ -222,45 +289,34 @@
 // See also: referencingConstraints and referencingConstraintsInSuperviews
 - (NSArray *) constraintsReferencingView: (VIEW_CLASS *) theView
 {
-    NSMutableArray *array = [NSMutableArray array];
-    NSArray *views = [@[self] arrayByAddingObjectsFromArray:self.superviews];
-
-    for (VIEW_CLASS *view in views)
-        for (NSLayoutConstraint *constraint in view.constraints)
-        {
-            if (![constraint.class isEqual:[NSLayoutConstraint class]])
-                continue;
-            
-            if ([constraint refersToView:theView])
-                [array addObject:constraint];
-        }
-    
-    return array;
+    CONSTRAINT_PROBE();
+    return IndexedConstraintsReferencingView(theView, self);
 }
 
 - (NSArray *) constraintsReferencingView: (VIEW_CLASS *) firstView andView: (VIEW_CLASS *) secondView
 {
-    NSArray *firstArray = [self constraintsReferencingView:firstView];
-
-    NSMutableArray *array = [NSMutableArray array];
-    for (NSLayoutConstraint *constraint in firstArray)
-    {
-        if ([constraint refersToView:secondView])
-            [array addObject:constraint];
-    }
-
-    return array;
+    CONSTRAINT_PROBE();
+    if (!firstView || !secondView) return @[];
+    
+    // Every constraint on the view refers to it twice over
+    if (firstView == secondView)
+        return [self constraintsReferencingView:firstView];
+    
+    // One pair probe per owner
+    return IndexedConstraintsBetweenItems(firstView, secondView, self);
 }
 
 // IB-sourced Constraints
 - (NSArray *) IBSourcedConstraintsReferencingView: (VIEW_CLASS *) theView
 {
+    CONSTRAINT_PROBE();
     return ConstraintsSourcedFromIB([self constraintsReferencingView:theView]);
 }
 
 // Remove constraint
 - (void) removeMatchingConstraint: (NSLayoutConstraint *) aConstraint
 {
+    CONSTRAINT_PROBE();
     NSLayoutConstraint *match = [self constraintMatchingConstraint:aConstraint];
     if (match)
         [match remove];
@@ -270,31 +326,140 @@
 // Use for removing constraings generated by format
 - (void) removeMatchingConstraints: (NSArray *) anArray
 {
+    CONSTRAINT_PROBE();
+    NSMutableArray *matches = [NSMutableArray array];
+    NSDictionary *table = SignatureTableForAscent(self);
     for (NSLayoutConstraint *constraint in anArray)
-        [self removeMatchingConstraint:constraint];
+    {
+        NSLayoutConstraint *match = MatchFromSignatureTable(table, constraint, YES);
+        if (match)
+            [matches addObject:match];
+    }
+    RemoveConstraints(matches);
 }
 
 // Remove constraints via name
 - (void) removeConstraintsNamed: (NSString *) name
 {
-    NSArray *array = [self constraintsNamed:name];
-    for (NSLayoutConstraint *constraint in array)
-        [constraint remove];
+    CONSTRAINT_PROBE();
+    // One removeConstraints: per owner
+    RemoveConstraints([self constraintsNamed:name]);
 }
 
 // Remove named constraints matching view
 - (void) removeConstraintsNamed: (NSString *) name matchingView: (VIEW_CLASS *) theView
 {
-    NSArray *array = [self constraintsNamed:name matchingView:theView];
-    for (NSLayoutConstraint *constraint in array)
-        [constraint remove];
+    CONSTRAINT_PROBE();
+    RemoveConstraints([self constraintsNamed:name matchingView:theView]);
+}
+
+// Component teardown by name, downward from self
+- (NSUInteger) removeSubtreeConstraintsNamed: (NSString *) name
+{
+    CONSTRAINT_PROBE();
+    if (!name) return 0;
+    return [self removeSubtreeConstraintsWithNames:@[name] removed:NULL];
+}
+
+- (NSUInteger) removeSubtreeConstraintsWithNames: (NSArray *) names removed: (NSArray **) removed
+{
+    CONSTRAINT_PROBE();
+    if (removed) *removed = @[];
+    
+    // A name never interned is on no constraint
+    NSMutableArray *atoms = [NSMutableArray array];
+    for (NSString *name in names)
+    {
+        NSString *atom = ExistingNametagAtom(name);
+        if (atom && ![atoms containsObject:atom])
+            [atoms addObject:atom];
+    }
+    if (!atoms.count) return 0;
+    
+    // Each subtree view's name buckets, in one pass
+    NSHashTable *members = [NSHashTable hashTableWithOptions:NSPointerFunctionsOpaqueMemory | NSPointerFunctionsOpaquePersonality];
+    NSMutableArray *constraints = [NSMutableArray array];
+    [self enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        [members addObject:view];
+        for (NSString *atom in atoms)
+            [constraints addObjectsFromArray:IndexedConstraintsNamedOnOwner(atom, view)];
+    }];
+    
+    // Named constraints pinning the subtree to the outside
+    for (VIEW_CLASS *owner = self.superview; owner != nil; owner = owner.superview)
+    {
+        for (NSString *atom in atoms)
+        {
+            for (NSLayoutConstraint *constraint in IndexedConstraintsNamedOnOwner(atom, owner))
+            {
+                if ([members containsObject:constraint.firstItem] || [members containsObject:constraint.secondItem])
+                    [constraints addObject:constraint];
+            }
+        }
+    }
+    
+    // Owners are already known, so removal batches by owner directly
+    RemoveConstraints(constraints);
+    if (removed) *removed = [constraints copy];
+    return constraints.count;
+}
+
+// Subtree teardown
+- (NSUInteger) removeConstraintsReferencingSubtree
+{
+    CONSTRAINT_PROBE();
+    NSMutableArray *members = [NSMutableArray array];
+    NSMutableArray *constraints = [NSMutableArray array];
+    
+    // A constraint held inside the subtree can only mention subtree
+    // views. Only the pack's own installs go: IB, layout guide and
+    // encapsulated layout constraints stay where they are. Each
+    // keeps its indexed owner, so removal batches without a lookup
+    [self enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        [members addObject:view];
+        for (NSLayoutConstraint *constraint in view.constraints)
+        {
+            if (constraint.installedByPack && (constraint.indexedOwner == view))
+                [constraints addObject:constraint];
+        }
+    }];
+    
+    // Superviews may hold constraints tying the subtree to the outside
+    for (NSLayoutConstraint *constraint in IndexedConstraintsReferencingViews(members, self.superview))
+    {
+        if (constraint.installedByPack)
+            [constraints addObject:constraint];
+    }
+    
+    RemoveConstraints(constraints);
+    return constraints.count;
 }
 
 // Width and height constraints are always installed to self
 
-// Constraints affecting view width
+// Constraints held by self on one axis, served from the index
+- (void) enumerateConstraintsAffectingAxis: (ConstraintAxis) axis kind: (ConstraintKind) kind usingBlock: (ConstraintEnumerationBlock) block
+{
+    CONSTRAINT_PROBE();
+    EnumerateIndexedConstraintsOnAxis(self, axis, kind, block);
+}
+
+- (NSArray *) constraintsAffectingAxis: (ConstraintAxis) axis kind: (ConstraintKind) kind
+{
+    CONSTRAINT_PROBE();
+    NSMutableArray *array = [NSMutableArray array];
+    EnumerateIndexedConstraintsOnAxis(self, axis, kind, ^(NSLayoutConstraint *constraint, BOOL *stop) {
+        [array addObject:constraint];
+    });
+    return array;
+}
+
+// Constraints affecting view width. Scans every constraint self
+// holds, content size constraints included, which the axis
+// buckets leave out
 - (NSArray *) widthConstraints
 {
+    CONSTRAINT_PROBE();
     NSMutableArray *array = [NSMutableArray array];
     
     for (NSLayoutConstraint *constraint in self.constraints)
@@ -322,16 +487,17 @@
     return array;
 }
 
-// Constraints affecting view height
+// Constraints affecting view height, scanned the same way
 - (NSArray *) heightConstraints
 {
+    CONSTRAINT_PROBE();
     NSMutableArray *array = [NSMutableArray array];
     
     for (NSLayoutConstraint *constraint in self.constraints)
     {
         if (constraint.firstAttribute == NSLayoutAttributeHeight)
             [array addObject:constraint];
-
+        
         if (constraint.firstItem != self) continue;
         if (constraint.secondItem != self) continue;
         if (
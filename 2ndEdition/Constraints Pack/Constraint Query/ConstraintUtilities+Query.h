@@ -0,0 +1,58 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#if TARGET_OS_IPHONE
+@import Foundation;
+#elif TARGET_OS_MAC
+#import <Foundation/Foundation.h>
+#endif
+
+#import "ConstraintUtilities+Install.h"
+#import "ConstraintUtilities+Index.h"
+
+/*
+ CONSTRAINT QUERIES
+ Compile a query once, then run it as often as you like. Clauses
+ join with &&:
+ 
+    ConstraintQuery *query = [ConstraintQuery queryWithString:
+        @"name == \"View Position\" && view == $v && axis == H && priority < 750"];
+    [query enumerateMatchesFromView:self bindings:@{@"v" : button}
+        usingBlock:^(NSLayoutConstraint *constraint, BOOL *stop) {...}];
+ 
+ Fields and the values they take:
+ 
+    name                          "string", $var, nil      == !=
+    view, first, second           $var, nil (not view)     == !=
+    axis                          H, V                     == !=
+    kind                          size, position           == !=
+    priority, constant,
+    multiplier                    number, $var             == != < <= > >=
+ 
+ view matches either item. axis and kind describe the first
+ attribute, as the axis index does. Variables are looked up in the
+ bindings each run.
+ 
+ A query searches the constraints installed on a view and its
+ superviews, the scope constraintsNamed: uses. Compiling picks the
+ narrowest index the clauses allow: name, then view, then axis,
+ falling back to a scan of each owner. Only NSLayoutConstraint
+ instances match. The remaining clauses filter each candidate, and
+ matches stream to the block, which can stop the run early. Do not
+ install or remove constraints from inside the block; collect them
+ with matchesFromView:bindings: first.
+ */
+
+@interface ConstraintQuery : NSObject
+// Logs and returns nil when the string does not parse
++ (instancetype) queryWithString: (NSString *) string;
+@property (nonatomic, readonly) NSString *string;
+@property (nonatomic, readonly) NSString *indexDescription; // name, view, axis or scan
+
+- (void) enumerateMatchesFromView: (VIEW_CLASS *) view bindings: (NSDictionary *) bindings usingBlock: (ConstraintEnumerationBlock) block;
+- (NSArray *) matchesFromView: (VIEW_CLASS *) view bindings: (NSDictionary *) bindings;
+- (NSLayoutConstraint *) firstMatchFromView: (VIEW_CLASS *) view bindings: (NSDictionary *) bindings;
+@end
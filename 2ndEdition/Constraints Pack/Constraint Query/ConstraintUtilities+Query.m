@@ -0,0 +1,493 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#import "ConstraintUtilities+Query.h"
+#import "ConstraintUtilities+Traits.h"
+#import "ConstraintUtilities+Instrumentation.h"
+#import "NametagUtilities.h"
+
+#pragma mark - Clauses
+
+typedef enum
+{
+    QueryFieldName,
+    QueryFieldView,
+    QueryFieldFirst,
+    QueryFieldSecond,
+    QueryFieldAxis,
+    QueryFieldKind,
+    QueryFieldPriority,
+    QueryFieldConstant,
+    QueryFieldMultiplier,
+} QueryField;
+
+typedef enum
+{
+    QueryOperatorEqual,
+    QueryOperatorNotEqual,
+    QueryOperatorLess,
+    QueryOperatorLessOrEqual,
+    QueryOperatorGreater,
+    QueryOperatorGreaterOrEqual,
+} QueryOperator;
+
+typedef enum
+{
+    QueryIndexScan,
+    QueryIndexAxis,
+    QueryIndexView,
+    QueryIndexName,
+} QueryIndex;
+
+// Objects live in the query's object array, so the
+// clause table stays a plain C array
+typedef struct
+{
+    QueryField field;
+    QueryOperator operator;
+    double number;          // numeric literal, or the axis or kind
+    NSInteger objectIndex;  // name atom or variable name, -1 for nil
+    BOOL isVariable;
+} QueryClause;
+
+static BOOL CompareNumbers(double lhs, QueryOperator operator, double rhs)
+{
+    switch (operator)
+    {
+        case QueryOperatorEqual: return lhs == rhs;
+        case QueryOperatorNotEqual: return lhs != rhs;
+        case QueryOperatorLess: return lhs < rhs;
+        case QueryOperatorLessOrEqual: return lhs <= rhs;
+        case QueryOperatorGreater: return lhs > rhs;
+        case QueryOperatorGreaterOrEqual: return lhs >= rhs;
+    }
+    return NO;
+}
+
+// Names are atoms, and views compare by identity
+static BOOL CompareObjects(id lhs, QueryOperator operator, id rhs)
+{
+    return (operator == QueryOperatorEqual) ? (lhs == rhs) : (lhs != rhs);
+}
+
+static BOOL ClauseMatches(QueryClause *clause, NSLayoutConstraint *constraint, id value)
+{
+    double number = clause->isVariable ? [value doubleValue] : clause->number;
+    switch (clause->field)
+    {
+        case QueryFieldName:
+            return CompareObjects(constraint.nametag, clause->operator, value);
+        case QueryFieldView:
+        {
+            BOOL refers = (constraint.firstItem == value) || (constraint.secondItem == value);
+            return (clause->operator == QueryOperatorEqual) ? refers : !refers;
+        }
+        case QueryFieldFirst:
+            return CompareObjects(constraint.firstItem, clause->operator, value);
+        case QueryFieldSecond:
+            return CompareObjects(constraint.secondItem, clause->operator, value);
+        case QueryFieldAxis:
+        {
+            NSUInteger trait = (clause->number == ConstraintAxisHorizontal) ? ConstraintTraitHorizontal : ConstraintTraitVertical;
+            BOOL onAxis = ConstraintAttributeHasTrait(constraint.firstAttribute, trait);
+            return (clause->operator == QueryOperatorEqual) ? onAxis : !onAxis;
+        }
+        case QueryFieldKind:
+        {
+            ConstraintKind kind = ConstraintAttributeHasTrait(constraint.firstAttribute, ConstraintTraitSize) ? ConstraintKindSize : ConstraintKindPosition;
+            return CompareNumbers(kind, clause->operator, clause->number);
+        }
+        case QueryFieldPriority:
+            return CompareNumbers(constraint.priority, clause->operator, number);
+        case QueryFieldConstant:
+            return CompareNumbers(constraint.constant, clause->operator, number);
+        case QueryFieldMultiplier:
+            return CompareNumbers(constraint.multiplier, clause->operator, number);
+    }
+    return NO;
+}
+
+#pragma mark - Parsing
+
+static NSDictionary *QueryFields()
+{
+    static NSDictionary *fields = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        fields = @{
+            @"name" : @(QueryFieldName),
+            @"view" : @(QueryFieldView),
+            @"first" : @(QueryFieldFirst),
+            @"second" : @(QueryFieldSecond),
+            @"axis" : @(QueryFieldAxis),
+            @"kind" : @(QueryFieldKind),
+            @"priority" : @(QueryFieldPriority),
+            @"constant" : @(QueryFieldConstant),
+            @"multiplier" : @(QueryFieldMultiplier),
+        };
+    });
+    return fields;
+}
+
+// Longer operators first, so <= is not read as <
+static BOOL ScanOperator(NSScanner *scanner, QueryOperator *operator)
+{
+    NSArray *tokens = @[@"==", @"!=", @"<=", @">=", @"<", @">"];
+    QueryOperator operators[] = {QueryOperatorEqual, QueryOperatorNotEqual, QueryOperatorLessOrEqual, QueryOperatorGreaterOrEqual, QueryOperatorLess, QueryOperatorGreater};
+    for (int i = 0; i < tokens.count; i++)
+    {
+        if ([scanner scanString:tokens[i] intoString:NULL])
+        {
+            *operator = operators[i];
+            return YES;
+        }
+    }
+    return NO;
+}
+
+#pragma mark - Queries
+
+@implementation ConstraintQuery
+{
+    QueryClause *_clauses;
+    NSInteger _count;
+    NSArray *_objects;
+    QueryIndex _index;
+    NSInteger _indexClause;     // clause that drives the index
+    NSInteger _viewClause;      // narrows a name lookup, -1 for none
+    NSInteger _kindClause;      // narrows an axis lookup, -1 for none
+}
+
+- (void) dealloc
+{
+    free(_clauses);
+}
+
+- (NSString *) indexDescription
+{
+    NSArray *names = @[@"scan", @"axis", @"view", @"name"];
+    return names[_index];
+}
+
+- (NSString *) description
+{
+    return [NSString stringWithFormat:@"<%@: \"%@\" (%d clauses, %@ index)>", self.class.description, _string, (int) _count, self.indexDescription];
+}
+
+- (BOOL) parse
+{
+    NSScanner *scanner = [NSScanner scannerWithString:_string];
+    scanner.charactersToBeSkipped = [NSCharacterSet whitespaceAndNewlineCharacterSet];
+    NSCharacterSet *identifierCharacters = [NSCharacterSet characterSetWithCharactersInString:@"abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_"];
+    
+    NSMutableArray *objects = [NSMutableArray array];
+    NSInteger capacity = 4;
+    _clauses = malloc(sizeof(QueryClause) * capacity);
+    if (!_clauses)
+    {
+        NSLog(@"Error: Out of memory compiling \"%@\"", _string);
+        return NO;
+    }
+    
+    do {
+        if (_count == capacity)
+        {
+            // A failed realloc leaves the old block to free
+            QueryClause *clauses = realloc(_clauses, sizeof(QueryClause) * capacity * 2);
+            if (!clauses)
+            {
+                NSLog(@"Error: Out of memory compiling \"%@\"", _string);
+                free(_clauses);
+                _clauses = NULL;
+                _count = 0;
+                return NO;
+            }
+            _clauses = clauses;
+            capacity *= 2;
+        }
+        QueryClause *clause = &_clauses[_count];
+        clause->number = 0;
+        clause->objectIndex = -1;
+        clause->isVariable = NO;
+    
+        NSString *fieldName = nil;
+        [scanner scanCharactersFromSet:identifierCharacters intoString:&fieldName];
+        NSNumber *field = fieldName ? QueryFields()[fieldName] : nil;
+        if (!field)
+        {
+            NSLog(@"Error: Query expected a field at offset %d in \"%@\"", (int) scanner.scanLocation, _string);
+            return NO;
+        }
+        clause->field = field.intValue;
+    
+        if (!ScanOperator(scanner, &clause->operator))
+        {
+            NSLog(@"Error: Query expected an operator after %@ in \"%@\"", fieldName, _string);
+            return NO;
+        }
+    
+        // Value: "string", $variable, number, or a bare word
+        NSString *word = nil;
+        BOOL isString = NO;
+        BOOL isNumber = NO;
+        if ([scanner scanString:@"\"" intoString:NULL])
+        {
+            // Keep the string's own spaces
+            word = @"";
+            NSCharacterSet *skipped = scanner.charactersToBeSkipped;
+            scanner.charactersToBeSkipped = nil;
+            [scanner scanUpToString:@"\"" intoString:&word];
+            scanner.charactersToBeSkipped = skipped;
+            if (![scanner scanString:@"\"" intoString:NULL])
+            {
+                NSLog(@"Error: Query has an unterminated string in \"%@\"", _string);
+                return NO;
+            }
+            isString = YES;
+        }
+        else if ([scanner scanString:@"$" intoString:NULL])
+        {
+            if (![scanner scanCharactersFromSet:identifierCharacters intoString:&word])
+            {
+                NSLog(@"Error: Query expected a variable name after $ in \"%@\"", _string);
+                return NO;
+            }
+            clause->isVariable = YES;
+            clause->objectIndex = objects.count;
+            [objects addObject:word];
+        }
+        else if ([scanner scanDouble:&clause->number])
+            isNumber = YES;
+        else if (![scanner scanCharactersFromSet:identifierCharacters intoString:&word])
+        {
+            NSLog(@"Error: Query expected a value after %@ in \"%@\"", fieldName, _string);
+            return NO;
+        }
+    
+        BOOL isNil = !isString && !isNumber && !clause->isVariable && [word isEqualToString:@"nil"];
+        BOOL isEquality = (clause->operator == QueryOperatorEqual) || (clause->operator == QueryOperatorNotEqual);
+        BOOL valid = NO;
+        switch (clause->field)
+        {
+            case QueryFieldName:
+                valid = isEquality && (isString || isNil || clause->isVariable);
+                if (isString)
+                {
+                    // Atoms compare by pointer, and interning now
+                    // means the name is ready when constraints take it
+                    clause->objectIndex = objects.count;
+                    [objects addObject:NametagAtom(word)];
+                }
+                break;
+            case QueryFieldView:
+                valid = isEquality && clause->isVariable;
+                break;
+            case QueryFieldFirst:
+            case QueryFieldSecond:
+                valid = isEquality && (clause->isVariable || isNil);
+                break;
+            case QueryFieldAxis:
+                valid = isEquality && ([word isEqualToString:@"H"] || [word isEqualToString:@"V"]) && !isString;
+                clause->number = [word isEqualToString:@"H"] ? ConstraintAxisHorizontal : ConstraintAxisVertical;
+                break;
+            case QueryFieldKind:
+                valid = isEquality && ([word isEqualToString:@"size"] || [word isEqualToString:@"position"]) && !isString;
+                clause->number = [word isEqualToString:@"size"] ? ConstraintKindSize : ConstraintKindPosition;
+                break;
+            case QueryFieldPriority:
+            case QueryFieldConstant:
+            case QueryFieldMultiplier:
+                valid = isNumber || clause->isVariable;
+                break;
+        }
+        if (!valid)
+        {
+            NSLog(@"Error: Query cannot compare %@ that way in \"%@\"", fieldName, _string);
+            return NO;
+        }
+        _count++;
+    } while ([scanner scanString:@"&&" intoString:NULL]);
+    
+    if (!scanner.isAtEnd)
+    {
+        NSLog(@"Error: Query has unexpected text at offset %d in \"%@\"", (int) scanner.scanLocation, _string);
+        return NO;
+    }
+    
+    _objects = [objects copy];
+    return YES;
+}
+
+// Pick the narrowest index the clauses allow. Only equality
+// with a real value can drive a lookup
+- (void) chooseIndex
+{
+    _index = QueryIndexScan;
+    _indexClause = -1;
+    _viewClause = -1;
+    _kindClause = -1;
+    
+    for (NSInteger i = 0; i < _count; i++)
+    {
+        QueryClause *clause = &_clauses[i];
+        if (clause->operator != QueryOperatorEqual)
+            continue;
+    
+        // Names and items index only with a value, not nil
+        QueryIndex index = QueryIndexScan;
+        switch (clause->field)
+        {
+            case QueryFieldName:
+                if (clause->objectIndex >= 0) index = QueryIndexName;
+                break;
+            case QueryFieldView:
+            case QueryFieldFirst:
+            case QueryFieldSecond:
+                if (clause->objectIndex >= 0) index = QueryIndexView;
+                break;
+            case QueryFieldAxis:
+                index = QueryIndexAxis;
+                break;
+            case QueryFieldKind:
+                _kindClause = i;
+                break;
+            default:
+                break;
+        }
+    
+        if ((clause->field == QueryFieldView) && (_viewClause < 0))
+            _viewClause = i;
+        if (index > _index)
+        {
+            _index = index;
+            _indexClause = i;
+        }
+    }
+}
+
+- (instancetype) initWithString: (NSString *) string
+{
+    if (!(self = [super init])) return self;
+    _string = [string copy];
+    if (![self parse])
+        return nil;
+    [self chooseIndex];
+    return self;
+}
+
++ (instancetype) queryWithString: (NSString *) string
+{
+    CONSTRAINT_PROBE();
+    if (!string.length)
+    {
+        NSLog(@"Error: Empty constraint query");
+        return nil;
+    }
+    return [[self alloc] initWithString:string];
+}
+
+#pragma mark - Running
+
+- (void) enumerateMatchesFromView: (VIEW_CLASS *) view bindings: (NSDictionary *) bindings usingBlock: (ConstraintEnumerationBlock) block
+{
+    CONSTRAINT_PROBE();
+    if (!view || !block) return;
+    
+    // Resolve every clause's value once per run. The bindings
+    // and the object array keep the values alive
+    __unsafe_unretained id resolved[MAX(_count, 1)];
+    __unsafe_unretained id *values = resolved;
+    for (NSInteger i = 0; i < _count; i++)
+    {
+        QueryClause *clause = &_clauses[i];
+        values[i] = (clause->objectIndex < 0) ? nil : _objects[clause->objectIndex];
+        if (!clause->isVariable)
+            continue;
+    
+        id value = bindings[values[i]];
+        if (!value)
+        {
+            NSLog(@"Error: Query has no binding for $%@", values[i]);
+            return;
+        }
+    
+        // An unknown name is on no constraint, and the bound
+        // string never equals an atom pointer
+        if (clause->field == QueryFieldName)
+            value = ExistingNametagAtom(value) ?: value;
+        values[i] = value;
+    }
+    
+    // Every candidate passes through the full clause list
+    QueryClause *clauses = _clauses;
+    NSInteger count = _count;
+    __block BOOL stopped = NO;
+    ConstraintEnumerationBlock filter = ^(NSLayoutConstraint *constraint, BOOL *stop) {
+        if (![constraint.class isEqual:[NSLayoutConstraint class]])
+            return;
+        for (NSInteger i = 0; i < count; i++)
+            if (!ClauseMatches(&clauses[i], constraint, values[i]))
+                return;
+        block(constraint, stop);
+        if (*stop) stopped = YES;
+    };
+    
+    switch (_index)
+    {
+        case QueryIndexName:
+        {
+            VIEW_CLASS *item = (_viewClause < 0) ? nil : values[_viewClause];
+            EnumerateIndexedConstraintsNamed(values[_indexClause], item, view, filter);
+            break;
+        }
+        case QueryIndexView:
+            EnumerateIndexedConstraintsReferencingView(values[_indexClause], view, filter);
+            break;
+        case QueryIndexAxis:
+        {
+            ConstraintAxis axis = (ConstraintAxis) _clauses[_indexClause].number;
+            ConstraintKind kind = (_kindClause < 0) ? ConstraintKindAny : (ConstraintKind) _clauses[_kindClause].number;
+            for (VIEW_CLASS *owner = view; owner && !stopped; owner = owner.superview)
+                EnumerateIndexedConstraintsOnAxis(owner, axis, kind, filter);
+            break;
+        }
+        case QueryIndexScan:
+        {
+            for (VIEW_CLASS *owner = view; owner && !stopped; owner = owner.superview)
+            {
+                BOOL stop = NO;
+                for (NSLayoutConstraint *constraint in owner.constraints)
+                {
+                    filter(constraint, &stop);
+                    if (stop) break;
+                }
+            }
+            break;
+        }
+    }
+}
+
+- (NSArray *) matchesFromView: (VIEW_CLASS *) view bindings: (NSDictionary *) bindings
+{
+    CONSTRAINT_PROBE();
+    NSMutableArray *array = [NSMutableArray array];
+    [self enumerateMatchesFromView:view bindings:bindings usingBlock:^(NSLayoutConstraint *constraint, BOOL *stop) {
+        [array addObject:constraint];
+    }];
+    return array;
+}
+
+- (NSLayoutConstraint *) firstMatchFromView: (VIEW_CLASS *) view bindings: (NSDictionary *) bindings
+{
+    CONSTRAINT_PROBE();
+    __block NSLayoutConstraint *match = nil;
+    [self enumerateMatchesFromView:view bindings:bindings usingBlock:^(NSLayoutConstraint *constraint, BOOL *stop) {
+        match = constraint;
+        *stop = YES;
+    }];
+    return match;
+}
+@end
@@ -0,0 +1,56 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#if TARGET_OS_IPHONE
+@import Foundation;
+#elif TARGET_OS_MAC
+#import <Foundation/Foundation.h>
+#endif
+
+#import "ConstraintUtilities+Install.h"
+
+/*
+ VISUAL FORMAT TEMPLATES
+ Parse each visual format once. A template records what the system
+ parser made of a (format, options, metric names, view names)
+ combination: for each constraint, which bound views it ties, which
+ attributes, relation and multiplier, and whether its constant and
+ priority are literals or come from a named metric. Instantiating
+ builds the constraints directly, with no string work.
+ 
+ Templates compile by running the format twice through the system
+ parser against stand-in views, with two different sets of stand-in
+ metric values. Anything that follows a metric is a metric slot;
+ anything that holds still is a literal. Formats that cannot be
+ captured this way, including those that do not parse, keep going
+ through the system parser on every call, so errors surface exactly
+ as before.
+ 
+ Compiling builds stand-in views, so compile on the main thread.
+ The template cache is a bounded LRU and is safe to share between
+ threads. Instantiating a template creates constraints only.
+ */
+
+#define VISUAL_TEMPLATE_DEFAULT_LIMIT 128
+
+@interface VisualFormatTemplate : NSObject
+@property (nonatomic, readonly) NSString *format;
+@property (nonatomic, readonly) NSLayoutFormatOptions options;
+@property (nonatomic, readonly) NSUInteger constraintCount;
+@property (nonatomic, readonly) BOOL isCompiled; // NO when it falls back to the system parser
+
+// Cached, compiling on a miss. metrics and bindings supply the names
++ (instancetype) templateForFormat: (NSString *) format options: (NSLayoutFormatOptions) options metrics: (NSDictionary *) metrics bindings: (NSDictionary *) bindings;
+- (NSArray *) constraintsWithMetrics: (NSDictionary *) metrics bindings: (NSDictionary *) bindings;
+@end
+
+// Drop-in for constraintsWithVisualFormat:options:metrics:views:
+NSArray *TemplateConstraints(NSString *format, NSLayoutFormatOptions options, NSDictionary *metrics, NSDictionary *bindings);
+
+// Cache management
+void SetVisualTemplateCacheLimit(NSUInteger limit);
+NSUInteger VisualTemplateCacheCount(void);
+void ClearVisualTemplateCache(void);
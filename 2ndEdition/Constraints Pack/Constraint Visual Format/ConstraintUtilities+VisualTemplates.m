@@ -0,0 +1,352 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#import "ConstraintUtilities+VisualTemplates.h"
+#import "ConstraintUtilities+Instrumentation.h"
+#import <pthread.h>
+
+#pragma mark - Specs
+
+#define VisualTemplateNoItem (-1)
+#define VisualTemplateSuperview (-2)
+
+// Stand-in metric values for the two compile passes. Both
+// stay inside the valid priority range
+#define VisualTemplateMetricLimit 490
+#define VisualTemplateProbeA(INDEX) (11 + 2 * (INDEX))
+#define VisualTemplateProbeB(INDEX) (12 + 2 * (INDEX))
+
+// One constraint, with view and metric slots in place of values
+typedef struct
+{
+    NSInteger firstItem;        // view slot or VisualTemplateSuperview
+    NSLayoutAttribute firstAttribute;
+    NSLayoutRelation relation;
+    NSInteger secondItem;       // view slot, VisualTemplateSuperview or VisualTemplateNoItem
+    NSLayoutAttribute secondAttribute;
+    CGFloat multiplier;
+    CGFloat constant;
+    NSInteger constantMetric;   // metric slot, -1 for a literal
+    CGFloat constantSign;
+    float priority;
+    NSInteger priorityMetric;   // metric slot, -1 for a literal
+} VisualTemplateSpec;
+
+// A metric slot is the one whose stand-ins the value followed
+// through both passes, either way round
+static BOOL FindMetricSlot(double a, double b, NSUInteger metricCount, NSInteger *slot, CGFloat *sign)
+{
+    for (NSUInteger i = 0; i < metricCount; i++)
+    {
+        for (int s = 1; s >= -1; s -= 2)
+        {
+            if ((a == s * VisualTemplateProbeA(i)) && (b == s * VisualTemplateProbeB(i)))
+            {
+                *slot = i;
+                *sign = s;
+                return YES;
+            }
+        }
+    }
+    return NO;
+}
+
+#pragma mark - Templates
+
+@implementation VisualFormatTemplate
+{
+    VisualTemplateSpec *_specs;
+    NSArray *_viewNames;
+    NSArray *_metricNames;
+@public
+    NSUInteger _lastUse; // cache recency, guarded by the cache lock
+}
+
+- (void) dealloc
+{
+    free(_specs);
+}
+
+- (NSString *) description
+{
+    return [NSString stringWithFormat:@"<%@: \"%@\" (%d constraints%@)>", self.class.description, _format, (int) _constraintCount, _isCompiled ? @"" : @", system parser"];
+}
+
+- (BOOL) matchesOptions: (NSLayoutFormatOptions) options metrics: (NSDictionary *) metrics bindings: (NSDictionary *) bindings
+{
+    if (options != _options) return NO;
+    if (metrics.count != _metricNames.count) return NO;
+    if (bindings.count != _viewNames.count) return NO;
+    for (NSString *name in _metricNames)
+        if (!metrics[name]) return NO;
+    for (NSString *name in _viewNames)
+        if (!bindings[name]) return NO;
+    return YES;
+}
+
+static NSInteger SlotForItem(id item, NSArray *standIns, VIEW_CLASS *container)
+{
+    if (!item) return VisualTemplateNoItem;
+    if (item == container) return VisualTemplateSuperview;
+    return [standIns indexOfObjectIdenticalTo:item];
+}
+
+- (BOOL) compile
+{
+    // Stand-ins share a parent so | can resolve
+    VIEW_CLASS *container = [[VIEW_CLASS alloc] init];
+    NSMutableArray *standIns = [NSMutableArray array];
+    NSMutableDictionary *views = [NSMutableDictionary dictionary];
+    for (NSString *name in _viewNames)
+    {
+        VIEW_CLASS *standIn = [[VIEW_CLASS alloc] init];
+        [container addSubview:standIn];
+        [standIns addObject:standIn];
+        views[name] = standIn;
+    }
+    
+    NSUInteger metricCount = _metricNames.count;
+    if (metricCount > VisualTemplateMetricLimit)
+        return NO;
+    NSMutableDictionary *metricsA = [NSMutableDictionary dictionary];
+    NSMutableDictionary *metricsB = [NSMutableDictionary dictionary];
+    for (NSUInteger i = 0; i < metricCount; i++)
+    {
+        metricsA[_metricNames[i]] = @(VisualTemplateProbeA(i));
+        metricsB[_metricNames[i]] = @(VisualTemplateProbeB(i));
+    }
+    
+    NSArray *passA = nil;
+    NSArray *passB = nil;
+    @try
+    {
+        passA = [NSLayoutConstraint constraintsWithVisualFormat:_format options:_options metrics:metricsA views:views];
+        passB = [NSLayoutConstraint constraintsWithVisualFormat:_format options:_options metrics:metricsB views:views];
+    }
+    @catch (NSException *exception)
+    {
+        return NO;
+    }
+    if (passA.count != passB.count)
+        return NO;
+    
+    VisualTemplateSpec *specs = calloc(MAX(passA.count, 1), sizeof(VisualTemplateSpec));
+    for (NSUInteger i = 0; i < passA.count; i++)
+    {
+        NSLayoutConstraint *a = passA[i];
+        NSLayoutConstraint *b = passB[i];
+        VisualTemplateSpec *spec = &specs[i];
+        
+        // The passes must agree on everything but the numbers
+        BOOL agree = [a.class isEqual:[NSLayoutConstraint class]] && [b.class isEqual:[NSLayoutConstraint class]] &&
+            (a.firstItem == b.firstItem) && (a.secondItem == b.secondItem) &&
+            (a.firstAttribute == b.firstAttribute) && (a.secondAttribute == b.secondAttribute) &&
+            (a.relation == b.relation) && (a.multiplier == b.multiplier);
+        
+        spec->firstItem = SlotForItem(a.firstItem, standIns, container);
+        spec->secondItem = SlotForItem(a.secondItem, standIns, container);
+        spec->firstAttribute = a.firstAttribute;
+        spec->secondAttribute = a.secondAttribute;
+        spec->relation = a.relation;
+        spec->multiplier = a.multiplier;
+        spec->constant = a.constant;
+        spec->constantMetric = -1;
+        spec->constantSign = 1;
+        spec->priority = a.priority;
+        spec->priorityMetric = -1;
+        
+        if (a.constant != b.constant)
+            agree = agree && FindMetricSlot(a.constant, b.constant, metricCount, &spec->constantMetric, &spec->constantSign);
+        if (a.priority != b.priority)
+        {
+            CGFloat sign = 1;
+            agree = agree && FindMetricSlot(a.priority, b.priority, metricCount, &spec->priorityMetric, &sign) && (sign > 0);
+        }
+        
+        // The superview is found through the other item
+        BOOL unresolved = (spec->firstItem == NSNotFound) || (spec->secondItem == NSNotFound) || (spec->firstItem == VisualTemplateSuperview && spec->secondItem < 0);
+        if (!agree || unresolved)
+        {
+            free(specs);
+            return NO;
+        }
+    }
+    
+    _specs = specs;
+    _constraintCount = passA.count;
+    return YES;
+}
+
+- (instancetype) initWithFormat: (NSString *) format options: (NSLayoutFormatOptions) options metrics: (NSDictionary *) metrics bindings: (NSDictionary *) bindings
+{
+    if (!(self = [super init])) return self;
+    _format = [format copy];
+    _options = options;
+    _metricNames = metrics.allKeys ?: @[];
+    _viewNames = bindings.allKeys ?: @[];
+    _isCompiled = [self compile];
+    return self;
+}
+
+static id TemplateItem(NSInteger slot, NSInteger otherSlot, __unsafe_unretained id *views)
+{
+    if (slot == VisualTemplateNoItem) return nil;
+    if (slot == VisualTemplateSuperview)
+        return [(VIEW_CLASS *) views[otherSlot] superview];
+    return views[slot];
+}
+
+- (NSArray *) constraintsWithMetrics: (NSDictionary *) metrics bindings: (NSDictionary *) bindings
+{
+    CONSTRAINT_PROBE();
+    if (!_isCompiled)
+        return [NSLayoutConstraint constraintsWithVisualFormat:_format options:_options metrics:metrics views:bindings];
+    
+    // Resolve the slots once. Anything missing goes to the
+    // system parser, which reports it as it always has
+    NSUInteger viewCount = _viewNames.count;
+    NSUInteger metricCount = _metricNames.count;
+    __unsafe_unretained id views[MAX(viewCount, 1)];
+    double values[MAX(metricCount, 1)];
+    for (NSUInteger i = 0; i < viewCount; i++)
+    {
+        views[i] = bindings[_viewNames[i]];
+        if (!views[i])
+            return [NSLayoutConstraint constraintsWithVisualFormat:_format options:_options metrics:metrics views:bindings];
+    }
+    for (NSUInteger i = 0; i < metricCount; i++)
+    {
+        NSNumber *value = metrics[_metricNames[i]];
+        if (!value)
+            return [NSLayoutConstraint constraintsWithVisualFormat:_format options:_options metrics:metrics views:bindings];
+        values[i] = value.doubleValue;
+    }
+    
+    NSMutableArray *constraints = [NSMutableArray arrayWithCapacity:_constraintCount];
+    for (NSUInteger i = 0; i < _constraintCount; i++)
+    {
+        VisualTemplateSpec *spec = &_specs[i];
+        id firstItem = TemplateItem(spec->firstItem, spec->secondItem, views);
+        id secondItem = TemplateItem(spec->secondItem, spec->firstItem, views);
+        if (!firstItem || ((spec->secondItem != VisualTemplateNoItem) && !secondItem))
+            return [NSLayoutConstraint constraintsWithVisualFormat:_format options:_options metrics:metrics views:bindings];
+        
+        CGFloat constant = (spec->constantMetric < 0) ? spec->constant : spec->constantSign * values[spec->constantMetric];
+        NSLayoutConstraint *constraint = [NSLayoutConstraint constraintWithItem:firstItem attribute:spec->firstAttribute relatedBy:spec->relation toItem:secondItem attribute:spec->secondAttribute multiplier:spec->multiplier constant:constant];
+        constraint.priority = (spec->priorityMetric < 0) ? spec->priority : values[spec->priorityMetric];
+        [constraints addObject:constraint];
+    }
+    return constraints;
+}
+
+#pragma mark - Cache
+
+// format -> templates for that format. Recency is a clock tick
+// per use; eviction scans for the oldest, which only happens
+// on a miss with a full cache
+static pthread_mutex_t templateLock = PTHREAD_MUTEX_INITIALIZER;
+static NSMutableDictionary *templateCache = nil;
+static NSUInteger templateCount = 0;
+static NSUInteger templateLimit = VISUAL_TEMPLATE_DEFAULT_LIMIT;
+static NSUInteger templateClock = 0;
+
+static VisualFormatTemplate *CachedTemplate(NSString *format, NSLayoutFormatOptions options, NSDictionary *metrics, NSDictionary *bindings)
+{
+    for (VisualFormatTemplate *template in templateCache[format])
+    {
+        if ([template matchesOptions:options metrics:metrics bindings:bindings])
+        {
+            template->_lastUse = ++templateClock;
+            return template;
+        }
+    }
+    return nil;
+}
+
+static void EvictTemplates(NSUInteger limit)
+{
+    while (templateCount > limit)
+    {
+        VisualFormatTemplate *oldest = nil;
+        for (NSString *format in templateCache)
+            for (VisualFormatTemplate *template in templateCache[format])
+                if (!oldest || (template->_lastUse < oldest->_lastUse))
+                    oldest = template;
+        
+        NSMutableArray *templates = templateCache[oldest.format];
+        [templates removeObjectIdenticalTo:oldest];
+        if (!templates.count)
+            [templateCache removeObjectForKey:oldest.format];
+        templateCount--;
+    }
+}
+
++ (instancetype) templateForFormat: (NSString *) format options: (NSLayoutFormatOptions) options metrics: (NSDictionary *) metrics bindings: (NSDictionary *) bindings
+{
+    CONSTRAINT_PROBE();
+    if (!format) return nil;
+    
+    pthread_mutex_lock(&templateLock);
+    VisualFormatTemplate *template = CachedTemplate(format, options, metrics, bindings);
+    pthread_mutex_unlock(&templateLock);
+    if (template) return template;
+    
+    // Compile outside the lock. If another thread got there
+    // first, keep its template
+    VisualFormatTemplate *compiled = [[VisualFormatTemplate alloc] initWithFormat:format options:options metrics:metrics bindings:bindings];
+    
+    pthread_mutex_lock(&templateLock);
+    template = CachedTemplate(format, options, metrics, bindings);
+    if (!template && templateLimit)
+    {
+        if (!templateCache)
+            templateCache = [NSMutableDictionary dictionary];
+        NSMutableArray *templates = templateCache[compiled.format];
+        if (!templates)
+        {
+            templates = [NSMutableArray array];
+            templateCache[compiled.format] = templates;
+        }
+        compiled->_lastUse = ++templateClock;
+        [templates addObject:compiled];
+        templateCount++;
+        EvictTemplates(templateLimit);
+    }
+    pthread_mutex_unlock(&templateLock);
+    return template ?: compiled;
+}
+@end
+
+NSArray *TemplateConstraints(NSString *format, NSLayoutFormatOptions options, NSDictionary *metrics, NSDictionary *bindings)
+{
+    CONSTRAINT_PROBE();
+    VisualFormatTemplate *template = [VisualFormatTemplate templateForFormat:format options:options metrics:metrics bindings:bindings];
+    return [template constraintsWithMetrics:metrics bindings:bindings];
+}
+
+void SetVisualTemplateCacheLimit(NSUInteger limit)
+{
+    pthread_mutex_lock(&templateLock);
+    templateLimit = limit;
+    EvictTemplates(limit);
+    pthread_mutex_unlock(&templateLock);
+}
+
+NSUInteger VisualTemplateCacheCount(void)
+{
+    pthread_mutex_lock(&templateLock);
+    NSUInteger count = templateCount;
+    pthread_mutex_unlock(&templateLock);
+    return count;
+}
+
+void ClearVisualTemplateCache(void)
+{
+    pthread_mutex_lock(&templateLock);
+    [templateCache removeAllObjects];
+    templateCount = 0;
+    pthread_mutex_unlock(&templateLock);
+}
@@ -0,0 +1,411 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+/*
+ VISUAL FORMAT DIALECT TESTS
+ Headless checks for VisualFormatDialect.c: expected specs for the
+ standard and extended forms, error cases, and a round trip that
+ writes every spec back out as a one-constraint format and reads it
+ again. Run with -b for a throughput benchmark. See the Makefile.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "VisualFormatDialect.h"
+
+static int failures = 0;
+static int checks = 0;
+
+#define CHECK(condition, ...) do { \
+    checks++; \
+    if (!(condition)) { \
+        failures++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+} while (0)
+
+// Expected Specs
+
+// Items are written as names, with "|" for the superview
+// and NULL for no second item
+typedef struct
+{
+    const char *firstItem;
+    int firstAttribute;
+    int relation;
+    const char *secondItem;
+    int secondAttribute;
+    double multiplier;
+    double constant;
+    double priority;
+} ExpectedSpec;
+
+static int ItemMatches(const VFLParseResult *result, int32_t item, const char *expected)
+{
+    if (!expected)
+        return item == VFLNoItem;
+    if (!strcmp(expected, "|"))
+        return item == VFLSuperview;
+    if ((item < 0) || ((size_t) item >= result->nameCount))
+        return 0;
+    const VFLName *name = &result->names[item];
+    return (name->length == strlen(expected)) && !memcmp(name->start, expected, name->length);
+}
+
+static void ExpectSpecs(const char *format, const ExpectedSpec *expected, size_t count)
+{
+    VFLParseResult result;
+    int parsed = VFLParse(format, strlen(format), &result);
+    CHECK(parsed, "\"%s\" did not parse: %s at %zu", format, result.error, result.errorOffset);
+    CHECK(result.specCount == count, "\"%s\" gave %zu specs, expected %zu", format, result.specCount, count);
+    
+    for (size_t i = 0; parsed && (i < count) && (i < result.specCount); i++)
+    {
+        const VFLConstraintSpec *spec = &result.specs[i];
+        const ExpectedSpec *want = &expected[i];
+        CHECK(ItemMatches(&result, spec->firstItem, want->firstItem), "\"%s\" spec %zu: first item", format, i);
+        CHECK(ItemMatches(&result, spec->secondItem, want->secondItem), "\"%s\" spec %zu: second item", format, i);
+        CHECK(spec->firstAttribute == want->firstAttribute, "\"%s\" spec %zu: first attribute %d, expected %d", format, i, spec->firstAttribute, want->firstAttribute);
+        CHECK(spec->secondAttribute == want->secondAttribute, "\"%s\" spec %zu: second attribute %d, expected %d", format, i, spec->secondAttribute, want->secondAttribute);
+        CHECK(spec->relation == want->relation, "\"%s\" spec %zu: relation %d, expected %d", format, i, spec->relation, want->relation);
+        CHECK(spec->multiplier == want->multiplier, "\"%s\" spec %zu: multiplier %g, expected %g", format, i, spec->multiplier, want->multiplier);
+        CHECK(spec->constant == want->constant, "\"%s\" spec %zu: constant %g, expected %g", format, i, spec->constant, want->constant);
+        CHECK(spec->priority == want->priority, "\"%s\" spec %zu: priority %g, expected %g", format, i, spec->priority, want->priority);
+    }
+    VFLParseResultRelease(&result);
+}
+
+#define EXPECT_SPECS(format, ...) do { \
+    const ExpectedSpec specs[] = {__VA_ARGS__}; \
+    ExpectSpecs(format, specs, sizeof(specs) / sizeof(specs[0])); \
+} while (0)
+
+static void TestStandardForms(void)
+{
+    EXPECT_SPECS("H:|-[a]-[b]-|",
+        {"a", VFLAttributeLeading, VFLRelationEqual, "|", VFLAttributeLeading, 1, VFL_SUPERVIEW_SPACING, 1000},
+        {"b", VFLAttributeLeading, VFLRelationEqual, "a", VFLAttributeTrailing, 1, VFL_SIBLING_SPACING, 1000},
+        {"|", VFLAttributeTrailing, VFLRelationEqual, "b", VFLAttributeTrailing, 1, VFL_SUPERVIEW_SPACING, 1000});
+    
+    EXPECT_SPECS("V:|[a][b]|",
+        {"a", VFLAttributeTop, VFLRelationEqual, "|", VFLAttributeTop, 1, 0, 1000},
+        {"b", VFLAttributeTop, VFLRelationEqual, "a", VFLAttributeBottom, 1, 0, 1000},
+        {"|", VFLAttributeBottom, VFLRelationEqual, "b", VFLAttributeBottom, 1, 0, 1000});
+    
+    // Implicit H:, constant and relational sizes
+    EXPECT_SPECS("[a(==44)]",
+        {"a", VFLAttributeWidth, VFLRelationEqual, NULL, VFLAttributeNone, 1, 44, 1000});
+    EXPECT_SPECS("V:[a(>=10,<=200@250)]",
+        {"a", VFLAttributeHeight, VFLRelationGreaterThanOrEqual, NULL, VFLAttributeNone, 1, 10, 1000},
+        {"a", VFLAttributeHeight, VFLRelationLessThanOrEqual, NULL, VFLAttributeNone, 1, 200, 250});
+    
+    // A bare name is the standard second item
+    EXPECT_SPECS("H:[b(==a)]",
+        {"b", VFLAttributeWidth, VFLRelationEqual, "a", VFLAttributeWidth, 1, 0, 1000});
+    
+    // Predicates follow the connection into the view
+    EXPECT_SPECS("H:[a]-(>=5,<=20@250)-[b(30)]",
+        {"b", VFLAttributeLeading, VFLRelationGreaterThanOrEqual, "a", VFLAttributeTrailing, 1, 5, 1000},
+        {"b", VFLAttributeLeading, VFLRelationLessThanOrEqual, "a", VFLAttributeTrailing, 1, 20, 250},
+        {"b", VFLAttributeWidth, VFLRelationEqual, NULL, VFLAttributeNone, 1, 30, 1000});
+    
+    EXPECT_SPECS("H:|-12-[a]-(-4)-|",
+        {"a", VFLAttributeLeading, VFLRelationEqual, "|", VFLAttributeLeading, 1, 12, 1000},
+        {"|", VFLAttributeTrailing, VFLRelationEqual, "a", VFLAttributeTrailing, 1, -4, 1000});
+}
+
+static void TestExtendedForms(void)
+{
+    // <name> marks the first item, as visualFormat writes it
+    EXPECT_SPECS("H:[view2(>=<view1> * 2 + 10)]",
+        {"view1", VFLAttributeWidth, VFLRelationGreaterThanOrEqual, "view2", VFLAttributeWidth, 2, 10, 1000});
+    EXPECT_SPECS("V:[b(<=<a> * 0.5 - 3 @ 500)]",
+        {"a", VFLAttributeHeight, VFLRelationLessThanOrEqual, "b", VFLAttributeHeight, 0.5, -3, 500});
+    
+    EXPECT_SPECS("H:|~<a>~|",
+        {"a", VFLAttributeCenterX, VFLRelationEqual, "|", VFLAttributeCenterX, 1, 0, 1000});
+    EXPECT_SPECS("V:~[<a>,<b>]~",
+        {"a", VFLAttributeCenterY, VFLRelationEqual, "b", VFLAttributeCenterY, 1, 0, 1000});
+    
+    EXPECT_SPECS("LTR:|-[a]-(8)-[b]",
+        {"a", VFLAttributeLeft, VFLRelationEqual, "|", VFLAttributeLeft, 1, VFL_SUPERVIEW_SPACING, 1000},
+        {"b", VFLAttributeLeft, VFLRelationEqual, "a", VFLAttributeRight, 1, 8, 1000});
+    
+    // objectName output: spaces and colons inside the delimiters
+    EXPECT_SPECS("H:[My View]-0-[UIView: 0x1]",
+        {"UIView: 0x1", VFLAttributeLeading, VFLRelationEqual, "My View", VFLAttributeTrailing, 1, 0, 1000});
+    
+    // %g output with an exponent
+    EXPECT_SPECS("H:[a(1e+06)]",
+        {"a", VFLAttributeWidth, VFLRelationEqual, NULL, VFLAttributeNone, 1, 1e6, 1000});
+    
+    // Several formats, one name table
+    const char *formats = "H:[a(10)];V:[a(20)]\nV:[b(30)]\n";
+    VFLParseResult result;
+    CHECK(VFLParse(formats, strlen(formats), &result), "multi-line source did not parse: %s", result.error);
+    CHECK(result.specCount == 3, "multi-line source gave %zu specs", result.specCount);
+    CHECK(result.nameCount == 2, "multi-line source gave %zu names", result.nameCount);
+    VFLParseResultRelease(&result);
+}
+
+static void ExpectError(const char *format, const char *message)
+{
+    VFLParseResult result;
+    int parsed = VFLParse(format, strlen(format), &result);
+    CHECK(!parsed, "\"%s\" parsed, expected \"%s\"", format, message);
+    CHECK(result.error && !strcmp(result.error, message), "\"%s\" failed with \"%s\", expected \"%s\"", format, result.error ? result.error : "(none)", message);
+    CHECK(!result.specCount && !result.nameCount, "\"%s\" kept specs after failing", format);
+    VFLParseResultRelease(&result);
+}
+
+static void TestErrors(void)
+{
+    ExpectError("H:[a", "Expected ]");
+    ExpectError("H:[]", "Expected a view name");
+    ExpectError("H:[a(==)]", "Expected a number or view name");
+    ExpectError("H:[a(10@0)]", "Priority must be between 1 and 1000");
+    ExpectError("H:[a(10@)]", "Expected a priority after @");
+    ExpectError("H:[a(==b*)]", "Expected a multiplier after *");
+    ExpectError("H:[a]-8[b]", "Expected - after spacing");
+    ExpectError("H:[a]-|x", "Expected the end of the format");
+    ExpectError("H:|~a~|", "Expected <view>");
+    ExpectError("V:~[<a>]~", "Expected ,");
+    
+    // Offsets point into the whole source, not the line: the )
+    const char *source = "H:[a]\nH:[b(>=)]";
+    VFLParseResult result;
+    VFLParse(source, strlen(source), &result);
+    CHECK(result.errorOffset == 13, "error offset %zu, expected 13", result.errorOffset);
+    VFLParseResultRelease(&result);
+    
+    CHECK(!VFLParse(NULL, 0, &result) && result.error, "NULL source parsed");
+    VFLParseResultRelease(&result);
+}
+
+// Round Trip
+
+static const char *AxisPrefix(int attribute)
+{
+    switch (attribute)
+    {
+        case VFLAttributeLeft: case VFLAttributeRight:
+            return "LTR:";
+        case VFLAttributeTop: case VFLAttributeBottom:
+        case VFLAttributeHeight: case VFLAttributeCenterY:
+            return "V:";
+        default:
+            return "H:";
+    }
+}
+
+static const char *RelationString(int relation)
+{
+    if (relation < 0) return "<=";
+    if (relation > 0) return ">=";
+    return "==";
+}
+
+static void WriteName(char *buffer, size_t size, const VFLParseResult *result, int32_t item)
+{
+    const VFLName *name = &result->names[item];
+    snprintf(buffer, size, "%.*s", (int) name->length, name->start);
+}
+
+// One spec as a one-constraint format, in the forms
+// visualFormat writes. Returns 0 for shapes it has no form for
+static int WriteSpec(char *buffer, size_t size, const VFLParseResult *result, const VFLConstraintSpec *spec)
+{
+    char first[256] = "", second[256] = "";
+    const char *axis = AxisPrefix(spec->firstAttribute);
+    const char *relation = RelationString(spec->relation);
+    if (spec->firstItem >= 0)
+        WriteName(first, sizeof(first), result, spec->firstItem);
+    if (spec->secondItem >= 0)
+        WriteName(second, sizeof(second), result, spec->secondItem);
+    
+    switch (spec->firstAttribute)
+    {
+        case VFLAttributeWidth: case VFLAttributeHeight:
+            if (spec->secondItem == VFLNoItem)
+                snprintf(buffer, size, "%s[%s(%s%.17g@%.17g)]", axis, first, relation, spec->constant, spec->priority);
+            else
+                snprintf(buffer, size, "%s[%s(%s<%s>*%.17g%+.17g@%.17g)]", axis, second, relation, first, spec->multiplier, spec->constant, spec->priority);
+            return 1;
+        case VFLAttributeCenterX: case VFLAttributeCenterY:
+            if (spec->secondItem == VFLSuperview)
+                snprintf(buffer, size, "%s|~<%s>~|", axis, first);
+            else
+                snprintf(buffer, size, "%s~[<%s>,<%s>]~", axis, first, second);
+            return 1;
+        case VFLAttributeLeading: case VFLAttributeLeft: case VFLAttributeTop:
+            if (spec->secondItem == VFLSuperview)
+                snprintf(buffer, size, "%s|-(%s%.17g@%.17g)-[%s]", axis, relation, spec->constant, spec->priority, first);
+            else
+                snprintf(buffer, size, "%s[%s]-(%s%.17g@%.17g)-[%s]", axis, second, relation, spec->constant, spec->priority, first);
+            return 1;
+        case VFLAttributeTrailing: case VFLAttributeRight: case VFLAttributeBottom:
+            if (spec->firstItem != VFLSuperview)
+                return 0;
+            snprintf(buffer, size, "%s[%s]-(%s%.17g@%.17g)-|", axis, second, relation, spec->constant, spec->priority);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int SameName(const VFLParseResult *result1, int32_t item1, const VFLParseResult *result2, int32_t item2)
+{
+    if ((item1 < 0) || (item2 < 0))
+        return item1 == item2;
+    const VFLName *name1 = &result1->names[item1];
+    const VFLName *name2 = &result2->names[item2];
+    return (name1->length == name2->length) && !memcmp(name1->start, name2->start, name1->length);
+}
+
+static void RoundTrip(const char *format)
+{
+    VFLParseResult result;
+    if (!VFLParse(format, strlen(format), &result))
+    {
+        CHECK(0, "\"%s\" did not parse: %s", format, result.error);
+        VFLParseResultRelease(&result);
+        return;
+    }
+    
+    for (size_t i = 0; i < result.specCount; i++)
+    {
+        const VFLConstraintSpec *spec = &result.specs[i];
+        char written[1024];
+        if (!WriteSpec(written, sizeof(written), &result, spec))
+        {
+            CHECK(0, "\"%s\" spec %zu has no written form", format, i);
+            continue;
+        }
+    
+        VFLParseResult reread;
+        int parsed = VFLParse(written, strlen(written), &reread);
+        CHECK(parsed && (reread.specCount == 1), "\"%s\" spec %zu wrote \"%s\", which read back as %zu specs (%s)", format, i, written, reread.specCount, reread.error ? reread.error : "no error");
+        if (parsed && (reread.specCount == 1))
+        {
+            const VFLConstraintSpec *back = &reread.specs[0];
+            int same = SameName(&result, spec->firstItem, &reread, back->firstItem) &&
+                SameName(&result, spec->secondItem, &reread, back->secondItem) &&
+                (spec->firstAttribute == back->firstAttribute) &&
+                (spec->secondAttribute == back->secondAttribute) &&
+                (spec->relation == back->relation) &&
+                (spec->multiplier == back->multiplier) &&
+                (spec->constant == back->constant) &&
+                (spec->priority == back->priority);
+            CHECK(same, "\"%s\" spec %zu did not survive \"%s\"", format, i, written);
+        }
+        VFLParseResultRelease(&reread);
+    }
+    VFLParseResultRelease(&result);
+}
+
+static void TestRoundTrips(void)
+{
+    const char *formats[] = {
+        "H:|-[a]-[b]-|",
+        "V:|-(>=8@750)-[a(44)]-0-[b(==a)]-(<=-2.5)-|",
+        "LTR:|[a]-(3,>=1e-3)-[b]|",
+        "H:[view2(>=<view1> * 2 + 10 @ 999)]",
+        "V:[b(<=<a> * 0.333 - 3)]",
+        "H:|~<a>~|",
+        "V:~[<My View>,<UIView: 0x1>]~",
+    };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++)
+        RoundTrip(formats[i]);
+}
+
+// Benchmark
+
+static double Seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Parse a many-line source repeatedly and report throughput
+static void Benchmark(void)
+{
+    const char *lines[] = {
+        "H:|-[view1]-[view2(>=<view1> * 2 + 10)]-|\n",
+        "V:|-(>=8@750)-[view1(44)]-0-[view2(==view1)]-|\n",
+        "H:|~<view3>~|\n",
+        "V:~[<view3>,<view4>]~\n",
+        "LTR:[view4]-(8)-[view5]\n",
+    };
+    size_t lineCount = sizeof(lines) / sizeof(lines[0]);
+    size_t repeats = 20000;
+    
+    size_t length = 0;
+    for (size_t i = 0; i < lineCount; i++)
+        length += strlen(lines[i]);
+    length *= repeats;
+    
+    char *source = malloc(length + 1);
+    if (!source)
+    {
+        printf("Out of memory\n");
+        return;
+    }
+    char *cursor = source;
+    for (size_t r = 0; r < repeats; r++)
+    {
+        for (size_t i = 0; i < lineCount; i++)
+        {
+            size_t lineLength = strlen(lines[i]);
+            memcpy(cursor, lines[i], lineLength);
+            cursor += lineLength;
+        }
+    }
+    *cursor = 0;
+    
+    int passes = 20;
+    size_t specs = 0;
+    double start = Seconds();
+    for (int pass = 0; pass < passes; pass++)
+    {
+        VFLParseResult result;
+        if (!VFLParse(source, length, &result))
+            printf("Benchmark source failed: %s\n", result.error);
+        specs += result.specCount;
+        VFLParseResultRelease(&result);
+    }
+    double elapsed = Seconds() - start;
+    
+    printf("{\"suite\" : \"VisualFormatDialect\", \"bytes\" : %zu, \"formats\" : %zu, \"passes\" : %d, "
+           "\"seconds\" : %.6f, \"mb_per_second\" : %.1f, \"specs_per_second\" : %.0f}\n",
+           length, lineCount * repeats, passes, elapsed,
+           (double) length * passes / elapsed / 1e6, specs / elapsed);
+    free(source);
+}
+
+int main(int argc, char *argv[])
+{
+    if ((argc > 1) && !strcmp(argv[1], "-b"))
+    {
+        Benchmark();
+        return 0;
+    }
+    
+    TestStandardForms();
+    TestExtendedForms();
+    TestErrors();
+    TestRoundTrips();
+    
+    printf("%d checks, %d failures\n", checks, failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,603 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "VisualFormatDialect.h"
+
+typedef struct
+{
+    const char *source;
+    const char *cursor;
+    const char *end;            // of the current line
+    VFLParseResult *result;
+    size_t specCapacity;
+    size_t nameCapacity;
+    int32_t *table;             // name indices, -1 when empty
+    size_t tableMask;
+    int8_t leading;
+    int8_t trailing;
+    int8_t size;
+    int8_t center;
+} VFLParser;
+
+// Items not yet known when a connection is read
+#define VFLPendingItem (-3)
+
+// Scanning
+
+static int Fail(VFLParser *parser, const char *message)
+{
+    parser->result->error = message;
+    parser->result->errorOffset = (size_t) (parser->cursor - parser->source);
+    return 0;
+}
+
+static int IsSpace(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+static int IsDigit(char c)
+{
+    return (c >= '0') && (c <= '9');
+}
+
+static int IsIdentifierStart(char c)
+{
+    return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || (c == '_');
+}
+
+static void SkipSpace(VFLParser *parser)
+{
+    while ((parser->cursor < parser->end) && IsSpace(*parser->cursor))
+        parser->cursor++;
+}
+
+// Next significant character, or 0 at the end of the line
+static char Peek(VFLParser *parser)
+{
+    SkipSpace(parser);
+    return (parser->cursor < parser->end) ? *parser->cursor : 0;
+}
+
+static int Accept(VFLParser *parser, char c)
+{
+    if (Peek(parser) != c)
+        return 0;
+    parser->cursor++;
+    return 1;
+}
+
+static int AcceptString(VFLParser *parser, const char *string)
+{
+    size_t length = strlen(string);
+    SkipSpace(parser);
+    if (((size_t) (parser->end - parser->cursor) < length) || memcmp(parser->cursor, string, length))
+        return 0;
+    parser->cursor += length;
+    return 1;
+}
+
+// Optional sign, digits, fraction and exponent. Reads the
+// same in every locale, unlike strtod
+static int ScanNumber(VFLParser *parser, double *value)
+{
+    SkipSpace(parser);
+    const char *c = parser->cursor;
+    const char *end = parser->end;
+    
+    double sign = 1;
+    if ((c < end) && ((*c == '-') || (*c == '+')))
+    {
+        if (*c == '-') sign = -1;
+        c++;
+    }
+    
+    double whole = 0;
+    int digits = 0;
+    for (; (c < end) && IsDigit(*c); c++, digits++)
+        whole = whole * 10 + (*c - '0');
+    
+    double fraction = 0;
+    double divisor = 1;
+    if ((c < end) && (*c == '.'))
+    {
+        for (c++; (c < end) && IsDigit(*c); c++, digits++)
+        {
+            fraction = fraction * 10 + (*c - '0');
+            divisor *= 10;
+        }
+    }
+    if (!digits)
+        return 0;
+    double number = whole + fraction / divisor;
+    
+    // %g writes large and small values with an exponent
+    if ((c < end) && ((*c == 'e') || (*c == 'E')))
+    {
+        const char *e = c + 1;
+        int negative = 0;
+        if ((e < end) && ((*e == '-') || (*e == '+')))
+        {
+            negative = (*e == '-');
+            e++;
+        }
+        int exponent = 0;
+        int exponentDigits = 0;
+        for (; (e < end) && IsDigit(*e); e++, exponentDigits++)
+            if (exponent < 400) exponent = exponent * 10 + (*e - '0');
+        if (exponentDigits)
+        {
+            c = e;
+            for (; exponent > 0; exponent--)
+                number = negative ? number / 10 : number * 10;
+        }
+    }
+    
+    *value = sign * number;
+    parser->cursor = c;
+    return 1;
+}
+
+// ==, <= or >=. Equal when absent
+static int8_t ScanRelation(VFLParser *parser)
+{
+    SkipSpace(parser);
+    if (((parser->end - parser->cursor) < 2) || (parser->cursor[1] != '='))
+        return VFLRelationEqual;
+    
+    int8_t relation;
+    switch (parser->cursor[0])
+    {
+        case '=': relation = VFLRelationEqual; break;
+        case '<': relation = VFLRelationLessThanOrEqual; break;
+        case '>': relation = VFLRelationGreaterThanOrEqual; break;
+        default: return VFLRelationEqual;
+    }
+    parser->cursor += 2;
+    return relation;
+}
+
+// @priority, 1000 when absent
+static int ScanPriority(VFLParser *parser, double *priority)
+{
+    *priority = 1000;
+    if (!Accept(parser, '@'))
+        return 1;
+    if (!ScanNumber(parser, priority))
+        return Fail(parser, "Expected a priority after @");
+    if ((*priority < 1) || (*priority > 1000))
+        return Fail(parser, "Priority must be between 1 and 1000");
+    return 1;
+}
+
+// Names
+
+static int32_t InternName(VFLParser *parser, const char *start, size_t length)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char) start[i];
+        hash *= 16777619u;
+    }
+    
+    VFLParseResult *result = parser->result;
+    size_t slot = hash & parser->tableMask;
+    for (; parser->table[slot] >= 0; slot = (slot + 1) & parser->tableMask)
+    {
+        VFLName *name = &result->names[parser->table[slot]];
+        if ((name->length == length) && !memcmp(name->start, start, length))
+            return parser->table[slot];
+    }
+    
+    // The pre-scan bounds the count, so this never fills
+    if (result->nameCount == parser->nameCapacity)
+        return VFLNoItem;
+    
+    int32_t index = (int32_t) result->nameCount++;
+    result->names[index].start = start;
+    result->names[index].length = length;
+    parser->table[slot] = index;
+    return index;
+}
+
+// Runs to the first stop character, trimmed. May hold spaces
+static int ScanDelimitedName(VFLParser *parser, const char *stops, int32_t *index)
+{
+    SkipSpace(parser);
+    const char *start = parser->cursor;
+    while ((parser->cursor < parser->end) && !strchr(stops, *parser->cursor))
+        parser->cursor++;
+    
+    const char *end = parser->cursor;
+    while ((end > start) && IsSpace(end[-1]))
+        end--;
+    if (end == start)
+        return Fail(parser, "Expected a view name");
+    
+    *index = InternName(parser, start, (size_t) (end - start));
+    return (*index >= 0) ? 1 : Fail(parser, "Too many view names");
+}
+
+static int ScanIdentifier(VFLParser *parser, int32_t *index)
+{
+    SkipSpace(parser);
+    const char *start = parser->cursor;
+    while ((parser->cursor < parser->end) &&
+           (IsIdentifierStart(*parser->cursor) || IsDigit(*parser->cursor)))
+        parser->cursor++;
+    
+    *index = InternName(parser, start, (size_t) (parser->cursor - start));
+    return (*index >= 0) ? 1 : Fail(parser, "Too many view names");
+}
+
+// Specs
+
+static int AddSpec(VFLParser *parser, int32_t firstItem, int8_t firstAttribute, int8_t relation, int32_t secondItem, int8_t secondAttribute, double multiplier, double constant, double priority)
+{
+    VFLParseResult *result = parser->result;
+    if (result->specCount == parser->specCapacity)
+        return Fail(parser, "Too many constraints");
+    
+    VFLConstraintSpec *spec = &result->specs[result->specCount++];
+    spec->firstItem = firstItem;
+    spec->secondItem = secondItem;
+    spec->firstAttribute = firstAttribute;
+    spec->secondAttribute = secondAttribute;
+    spec->relation = relation;
+    spec->multiplier = multiplier;
+    spec->constant = constant;
+    spec->priority = priority;
+    return 1;
+}
+
+// Predicate inside a view: rel? (number | name | <name>) (* m)? (± c)? (@p)?
+static int ParseViewPredicate(VFLParser *parser, int32_t view)
+{
+    int8_t relation = ScanRelation(parser);
+    char next = Peek(parser);
+    
+    // Constant size
+    double value;
+    if (!IsIdentifierStart(next) && (next != '<'))
+    {
+        if (!ScanNumber(parser, &value))
+            return Fail(parser, "Expected a number or view name");
+        double priority;
+        if (!ScanPriority(parser, &priority))
+            return 0;
+        return AddSpec(parser, view, parser->size, relation, VFLNoItem, VFLAttributeNone, 1, value, priority);
+    }
+    
+    // Relative size. <name> is the first item, as visualFormat
+    // writes it. A bare name is the standard second item
+    int32_t other;
+    int angled = Accept(parser, '<');
+    if (angled)
+    {
+        if (!ScanDelimitedName(parser, ">", &other))
+            return 0;
+        if (!Accept(parser, '>'))
+            return Fail(parser, "Expected >");
+    }
+    else if (!ScanIdentifier(parser, &other))
+        return 0;
+    
+    double multiplier = 1;
+    if (Accept(parser, '*') && !ScanNumber(parser, &multiplier))
+        return Fail(parser, "Expected a multiplier after *");
+    
+    double constant = 0;
+    next = Peek(parser);
+    if ((next == '+') || (next == '-'))
+    {
+        parser->cursor++;
+        if (!ScanNumber(parser, &constant))
+            return Fail(parser, "Expected a constant");
+        if (next == '-')
+            constant = -constant;
+    }
+    
+    double priority;
+    if (!ScanPriority(parser, &priority))
+        return 0;
+    
+    if (angled)
+        return AddSpec(parser, other, parser->size, relation, view, parser->size, multiplier, constant, priority);
+    return AddSpec(parser, view, parser->size, relation, other, parser->size, multiplier, constant, priority);
+}
+
+// [name] or [name(predicate, ...)]
+static int ParseView(VFLParser *parser, int32_t *view)
+{
+    if (!Accept(parser, '['))
+        return Fail(parser, "Expected [");
+    if (!ScanDelimitedName(parser, "(]", view))
+        return 0;
+    
+    if (Accept(parser, '('))
+    {
+        do
+        {
+            if (!ParseViewPredicate(parser, *view))
+                return 0;
+        }
+        while (Accept(parser, ','));
+        if (!Accept(parser, ')'))
+            return Fail(parser, "Expected )");
+    }
+    
+    if (!Accept(parser, ']'))
+        return Fail(parser, "Expected ]");
+    return 1;
+}
+
+// rel? number (@p)?
+static int ParseConnectionPredicate(VFLParser *parser)
+{
+    int8_t relation = ScanRelation(parser);
+    double constant, priority;
+    if (!ScanNumber(parser, &constant))
+        return Fail(parser, "Expected a spacing value");
+    if (!ScanPriority(parser, &priority))
+        return 0;
+    return AddSpec(parser, VFLPendingItem, VFLAttributeNone, relation, VFLPendingItem, VFLAttributeNone, 1, constant, priority);
+}
+
+// Flush, -, -N- or -(predicate, ...)-. Adds specs whose items
+// are filled in once both ends are known
+static int ParseConnection(VFLParser *parser, int *standardSpacing)
+{
+    *standardSpacing = 0;
+    
+    char next = Peek(parser);
+    if ((next == '[') || (next == '|'))
+        return AddSpec(parser, VFLPendingItem, VFLAttributeNone, VFLRelationEqual, VFLPendingItem, VFLAttributeNone, 1, 0, 1000);
+    if (!Accept(parser, '-'))
+        return Fail(parser, "Expected a connection");
+    
+    next = Peek(parser);
+    if ((next == '[') || (next == '|'))
+    {
+        *standardSpacing = 1;
+        return AddSpec(parser, VFLPendingItem, VFLAttributeNone, VFLRelationEqual, VFLPendingItem, VFLAttributeNone, 1, 0, 1000);
+    }
+    
+    if (Accept(parser, '('))
+    {
+        do
+        {
+            if (!ParseConnectionPredicate(parser))
+                return 0;
+        }
+        while (Accept(parser, ','));
+        if (!Accept(parser, ')'))
+            return Fail(parser, "Expected )");
+    }
+    else if (!ParseConnectionPredicate(parser))
+        return 0;
+    
+    if (!Accept(parser, '-'))
+        return Fail(parser, "Expected - after spacing");
+    return 1;
+}
+
+// firstItem.firstAttribute rel secondItem.secondAttribute + spacing
+static void ResolveConnection(VFLParser *parser, size_t from, size_t to, int standardSpacing, int32_t firstItem, int8_t firstAttribute, int32_t secondItem, int8_t secondAttribute)
+{
+    int touchesSuperview = (firstItem == VFLSuperview) || (secondItem == VFLSuperview);
+    for (size_t i = from; i < to; i++)
+    {
+        VFLConstraintSpec *spec = &parser->result->specs[i];
+        spec->firstItem = firstItem;
+        spec->firstAttribute = firstAttribute;
+        spec->secondItem = secondItem;
+        spec->secondAttribute = secondAttribute;
+        if (standardSpacing)
+            spec->constant = touchesSuperview ? VFL_SUPERVIEW_SPACING : VFL_SIBLING_SPACING;
+    }
+}
+
+// Lines
+
+// |~<view>~| and ~[<view1>,<view2>]~
+static int ParseCenterLine(VFLParser *parser)
+{
+    int32_t first, second;
+    if (AcceptString(parser, "|~"))
+    {
+        if (!Accept(parser, '<') || !ScanDelimitedName(parser, ">", &first) || !Accept(parser, '>'))
+            return Fail(parser, "Expected <view>");
+        if (!AcceptString(parser, "~|"))
+            return Fail(parser, "Expected ~|");
+        return AddSpec(parser, first, parser->center, VFLRelationEqual, VFLSuperview, parser->center, 1, 0, 1000);
+    }
+    
+    if (!AcceptString(parser, "~["))
+        return Fail(parser, "Expected |~ or ~[");
+    if (!Accept(parser, '<') || !ScanDelimitedName(parser, ">", &first) || !Accept(parser, '>'))
+        return Fail(parser, "Expected <view>");
+    if (!Accept(parser, ','))
+        return Fail(parser, "Expected ,");
+    if (!Accept(parser, '<') || !ScanDelimitedName(parser, ">", &second) || !Accept(parser, '>'))
+        return Fail(parser, "Expected <view>");
+    if (!AcceptString(parser, "]~"))
+        return Fail(parser, "Expected ]~");
+    return AddSpec(parser, first, parser->center, VFLRelationEqual, second, parser->center, 1, 0, 1000);
+}
+
+// (|connection)? [view] (connection [view])* (connection|)?
+static int ParseStandardLine(VFLParser *parser)
+{
+    VFLParseResult *result = parser->result;
+    int32_t previous = VFLNoItem;
+    size_t from = 0;
+    int standardSpacing = 0;
+    
+    if (Accept(parser, '|'))
+    {
+        previous = VFLSuperview;
+        from = result->specCount;
+        if (!ParseConnection(parser, &standardSpacing))
+            return 0;
+    }
+    
+    while (1)
+    {
+        // Predicates follow the connection specs
+        size_t predicates = result->specCount;
+        int32_t view;
+        if (!ParseView(parser, &view))
+            return 0;
+    
+        // |-N-[view] and [previous]-N-[view]
+        if (previous == VFLSuperview)
+            ResolveConnection(parser, from, predicates, standardSpacing, view, parser->leading, VFLSuperview, parser->leading);
+        else if (previous != VFLNoItem)
+            ResolveConnection(parser, from, predicates, standardSpacing, view, parser->leading, previous, parser->trailing);
+    
+        if (!Peek(parser))
+            return 1;
+    
+        from = result->specCount;
+        if (!ParseConnection(parser, &standardSpacing))
+            return 0;
+    
+        // [view]-N-|
+        if (Accept(parser, '|'))
+        {
+            ResolveConnection(parser, from, result->specCount, standardSpacing, VFLSuperview, parser->trailing, view, parser->trailing);
+            return Peek(parser) ? Fail(parser, "Expected the end of the format") : 1;
+        }
+        previous = view;
+    }
+}
+
+static int ParseLine(VFLParser *parser)
+{
+    if (AcceptString(parser, "LTR:"))
+    {
+        parser->leading = VFLAttributeLeft;
+        parser->trailing = VFLAttributeRight;
+        parser->size = VFLAttributeWidth;
+        parser->center = VFLAttributeCenterX;
+    }
+    else if (AcceptString(parser, "V:"))
+    {
+        parser->leading = VFLAttributeTop;
+        parser->trailing = VFLAttributeBottom;
+        parser->size = VFLAttributeHeight;
+        parser->center = VFLAttributeCenterY;
+    }
+    else
+    {
+        AcceptString(parser, "H:");
+        parser->leading = VFLAttributeLeading;
+        parser->trailing = VFLAttributeTrailing;
+        parser->size = VFLAttributeWidth;
+        parser->center = VFLAttributeCenterX;
+    }
+    
+    SkipSpace(parser);
+    const char *c = parser->cursor;
+    if (((parser->end - c) >= 2) &&
+        (((c[0] == '|') && (c[1] == '~')) || ((c[0] == '~') && (c[1] == '['))))
+        return ParseCenterLine(parser);
+    return ParseStandardLine(parser);
+}
+
+// Parsing
+
+int VFLParse(const char *source, size_t length, VFLParseResult *result)
+{
+    memset(result, 0, sizeof(*result));
+    if (!source)
+    {
+        result->error = "No format";
+        return 0;
+    }
+    
+    // Every spec and name starts at one of these delimiters, so
+    // a single pass bounds the whole allocation
+    size_t specCapacity = 0;
+    size_t nameCapacity = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        switch (source[i])
+        {
+            case '[': case '(': case ',':
+                specCapacity++;
+                nameCapacity++;
+                break;
+            case '<':
+                nameCapacity++;
+                break;
+            case '|': case '~':
+                specCapacity++;
+                break;
+            default:
+                break;
+        }
+    }
+    
+    size_t tableSize = 1;
+    while (tableSize < nameCapacity * 2)
+        tableSize <<= 1;
+    
+    size_t specBytes = specCapacity * sizeof(VFLConstraintSpec);
+    size_t nameBytes = nameCapacity * sizeof(VFLName);
+    char *arena = malloc(specBytes + nameBytes + tableSize * sizeof(int32_t));
+    if (!arena)
+    {
+        result->error = "Out of memory";
+        return 0;
+    }
+    
+    result->arena = arena;
+    result->specs = (VFLConstraintSpec *) arena;
+    result->names = (VFLName *) (arena + specBytes);
+    
+    VFLParser parser = {0};
+    parser.source = source;
+    parser.result = result;
+    parser.specCapacity = specCapacity;
+    parser.nameCapacity = nameCapacity;
+    parser.table = (int32_t *) (arena + specBytes + nameBytes);
+    parser.tableMask = tableSize - 1;
+    memset(parser.table, 0xFF, tableSize * sizeof(int32_t));
+    
+    // One format per line or per semicolon
+    const char *end = source + length;
+    for (const char *line = source; line < end;)
+    {
+        const char *lineEnd = line;
+        while ((lineEnd < end) && (*lineEnd != '\n') && (*lineEnd != ';'))
+            lineEnd++;
+    
+        parser.cursor = line;
+        parser.end = lineEnd;
+        if (Peek(&parser) && !ParseLine(&parser))
+        {
+            result->specCount = 0;
+            result->nameCount = 0;
+            return 0;
+        }
+        line = lineEnd + 1;
+    }
+    
+    return 1;
+}
+
+void VFLParseResultRelease(VFLParseResult *result)
+{
+    if (!result) return;
+    free(result->arena);
+    memset(result, 0, sizeof(*result));
+}
@@ -0,0 +1,105 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#ifndef VISUAL_FORMAT_DIALECT_H
+#define VISUAL_FORMAT_DIALECT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ VISUAL FORMAT DIALECT
+ A plain C reader for the formats -[NSLayoutConstraint visualFormat]
+ writes: standard visual format plus the pack's extensions.
+ 
+    H:|~<view>~|              view centered in its superview
+    V:~[<view1>,<view2>]~     two views sharing a center
+    LTR:[view1]-(8)-[view2]   left and right rather than leading and trailing
+    H:[view2(>=<view1> * 2 + 10)]
+                              view1.width >= view2.width * 2 + 10
+ 
+ In a view's predicate, a bare identifier is the standard form:
+ [b(==a)] makes b.width == a.width. An <angled> name is the
+ extension: it marks the first item, as visualFormat writes it.
+ Predicates take numbers, not metric names. Bracketed and angled
+ names run to their closing delimiter and may hold spaces and
+ colons, so objectName output reads back as written.
+ 
+ A source may hold several formats, one per line or separated by
+ semicolons, so names cannot hold either. Each parse makes one
+ allocation, which holds the specs and the name table. Names point
+ into the source, so keep the source alive while you use them. No
+ Foundation, no locale: this builds and runs anywhere a C compiler
+ does. Tests/ holds a headless test driver and benchmark.
+ */
+
+// Raw values match NSLayoutAttribute and NSLayoutRelation
+typedef enum
+{
+    VFLAttributeNone = 0,
+    VFLAttributeLeft = 1,
+    VFLAttributeRight = 2,
+    VFLAttributeTop = 3,
+    VFLAttributeBottom = 4,
+    VFLAttributeLeading = 5,
+    VFLAttributeTrailing = 6,
+    VFLAttributeWidth = 7,
+    VFLAttributeHeight = 8,
+    VFLAttributeCenterX = 9,
+    VFLAttributeCenterY = 10,
+} VFLAttribute;
+
+typedef enum
+{
+    VFLRelationLessThanOrEqual = -1,
+    VFLRelationEqual = 0,
+    VFLRelationGreaterThanOrEqual = 1,
+} VFLRelation;
+
+// Item slots other than name table indices
+#define VFLNoItem (-1)
+#define VFLSuperview (-2)
+
+typedef struct
+{
+    int32_t firstItem;          // name index or VFLSuperview
+    int32_t secondItem;         // name index, VFLSuperview or VFLNoItem
+    int8_t firstAttribute;
+    int8_t secondAttribute;
+    int8_t relation;
+    double multiplier;
+    double constant;
+    double priority;            // 1000 unless given with @
+} VFLConstraintSpec;
+
+// Not NUL-terminated
+typedef struct
+{
+    const char *start;
+    size_t length;
+} VFLName;
+
+typedef struct
+{
+    VFLConstraintSpec *specs;
+    size_t specCount;
+    VFLName *names;             // distinct, in order of appearance
+    size_t nameCount;
+    const char *error;          // static message, NULL on success
+    size_t errorOffset;         // into the source
+    void *arena;
+} VFLParseResult;
+
+// Returns 1 on success. On failure, result holds the error and
+// no specs. Either way, release the result when done
+int VFLParse(const char *source, size_t length, VFLParseResult *result);
+void VFLParseResultRelease(VFLParseResult *result);
+
+// Standard spacing, as the system parser used it
+#define VFL_SIBLING_SPACING 8
+#define VFL_SUPERVIEW_SPACING 20
+
+#endif
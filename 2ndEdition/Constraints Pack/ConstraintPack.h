@@ -13,9 +13,15 @@
 #import "NametagUtilities.h"
 
 #import "ConstraintUtilities+Install.h"
+#import "ConstraintUtilities+Index.h"
 #import "ConstraintUtilities+Matching.h"
+#import "ConstraintUtilities+Diff.h"
+#import "ConstraintUtilities+Query.h"
 #import "ConstraintUtilities+Layout.h"
+#import "ConstraintUtilities+VisualTemplates.h"
+#import "VisualFormatDialect.h"
 #import "ConstraintUtilities+Description.h"
 #import "ConstraintUtilities+Utility.h"
 #import "ConstraintUtilities+CreationMacros.h"
+#import "ConstraintUtilities+Instrumentation.h"
 
@@ -17,7 +17,31 @@
 // If you use in production code, please make sure to add
 // namespace indicators to class category methods
 
+/*
+ NAMETAG ATOMS
+ Nametags are interned. The setter stores one canonical copy of each
+ distinct string, shared by every object carrying that tag, so two
+ nametags are equal exactly when their pointers are. Canonicalize a
+ query once with ExistingNametagAtom and compare with ==.
+ 
+ Lookups take no locks. Interning a new string takes a lock briefly.
+ Atoms are never freed, so keep nametags to a working vocabulary
+ rather than, say, one unique string per frame.
+ */
+
+// The canonical copy of name, interning it on first use
+NSString *NametagAtom(NSString *name);
+
+// The canonical copy if name was ever interned, otherwise nil.
+// Nothing with a nametag can match a string that returns nil
+NSString *ExistingNametagAtom(NSString *name);
+
+// Table usage: distinct atoms, and bytes of table overhead
+// not counting the strings themselves
+NSUInteger NametagAtomCount(void);
+NSUInteger NametagAtomTableBytes(void);
+
 @interface NSObject (Nametags)
 @property (nonatomic, strong) NSString *nametag;
+- (BOOL) hasNametag: (NSString *) name;
 @end
-
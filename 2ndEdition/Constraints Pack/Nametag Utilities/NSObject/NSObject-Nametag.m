@@ -6,6 +6,8 @@
 
 
 #import "NSObject-Nametag.h"
+#import <stdatomic.h>
+#import <pthread.h>
 
 #if TARGET_OS_IPHONE
 @import ObjectiveC;
@@ -13,6 +15,82 @@
 #import <objc/objc-runtime.h>
 #endif
 
+#pragma mark - Atoms
+
+#define NAMETAG_ATOM_BUCKETS 1024
+
+// Entries are published whole and never change or go away,
+// so readers can walk a chain without locking
+typedef struct NametagAtomEntry
+{
+    NSUInteger hash;
+    CFStringRef string;
+    struct NametagAtomEntry *next;
+} NametagAtomEntry;
+
+static _Atomic(NametagAtomEntry *) atomBuckets[NAMETAG_ATOM_BUCKETS];
+static _Atomic(NSUInteger) atomCount = 0;
+static pthread_mutex_t atomLock = PTHREAD_MUTEX_INITIALIZER;
+
+static NSString *FindNametagAtom(NSString *name, NSUInteger hash)
+{
+    NametagAtomEntry *entry = atomic_load_explicit(&atomBuckets[hash % NAMETAG_ATOM_BUCKETS], memory_order_acquire);
+    for (; entry; entry = entry->next)
+    {
+        NSString *atom = (__bridge NSString *) entry->string;
+        if (atom == name)
+            return atom;
+        if ((entry->hash == hash) && [atom isEqualToString:name])
+            return atom;
+    }
+    return nil;
+}
+
+NSString *ExistingNametagAtom(NSString *name)
+{
+    if (!name) return nil;
+    return FindNametagAtom(name, name.hash);
+}
+
+NSString *NametagAtom(NSString *name)
+{
+    if (!name) return nil;
+    
+    NSUInteger hash = name.hash;
+    NSString *atom = FindNametagAtom(name, hash);
+    if (atom) return atom;
+    
+    // Writers serialize and recheck, so each string is interned once
+    pthread_mutex_lock(&atomLock);
+    atom = FindNametagAtom(name, hash);
+    if (!atom)
+    {
+        _Atomic(NametagAtomEntry *) *bucket = &atomBuckets[hash % NAMETAG_ATOM_BUCKETS];
+        NametagAtomEntry *entry = malloc(sizeof(NametagAtomEntry));
+        entry->hash = hash;
+        entry->string = CFBridgingRetain([name copy]);
+        entry->next = atomic_load_explicit(bucket, memory_order_relaxed);
+        atomic_store_explicit(bucket, entry, memory_order_release);
+        atomic_fetch_add_explicit(&atomCount, 1, memory_order_relaxed);
+        atom = (__bridge NSString *) entry->string;
+    }
+    pthread_mutex_unlock(&atomLock);
+    
+    return atom;
+}
+
+NSUInteger NametagAtomCount(void)
+{
+    return atomic_load_explicit(&atomCount, memory_order_relaxed);
+}
+
+NSUInteger NametagAtomTableBytes(void)
+{
+    return sizeof(atomBuckets) + NametagAtomCount() * sizeof(NametagAtomEntry);
+}
+
+#pragma mark - Nametags
+
 @implementation NSObject (Nametags)
 - (id) nametag
 {
@@ -21,6 +99,12 @@
 
 - (void) setNametag: (NSString *) nametag
 {
-    objc_setAssociatedObject(self, @selector(nametag), nametag, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    objc_setAssociatedObject(self, @selector(nametag), NametagAtom(nametag), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+- (BOOL) hasNametag: (NSString *) name
+{
+    NSString *atom = ExistingNametagAtom(name);
+    return atom && (self.nametag == atom);
 }
-@end
\ No newline at end of file
+@end
@@ -8,3 +8,5 @@
 #import "NSObject-Nametag.h"
 #import "NSObject-Description.h"
 #import "View-Nametag.h"
+#import "View-Traversal.h"
+#import "View-Generation.h"
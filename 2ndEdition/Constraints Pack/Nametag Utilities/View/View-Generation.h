@@ -0,0 +1,82 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#if TARGET_OS_IPHONE
+@import Foundation;
+#elif TARGET_OS_MAC
+#import <Foundation/Foundation.h>
+#endif
+
+#ifndef VIEW_CLASS
+#if TARGET_OS_IPHONE
+    @import UIKit;
+    #define VIEW_CLASS UIView
+    #define COLOR_CLASS UIColor
+    #define IMAGE_CLASS UIImage
+#elif TARGET_OS_MAC
+    #define VIEW_CLASS NSView
+    #define COLOR_CLASS NSColor
+    #define IMAGE_CLASS NSImage
+#endif
+#endif
+
+// If you use in production code, please make sure to add
+// namespace indicators to class category methods
+
+/*
+ 
+ Hierarchy Generations
+ Each window, or the root of a detached tree, carries a generation
+ number. Adding or removing a subview, a view nametag change, and
+ the constraint pack's installs, removals and constraint renames
+ all give that window a fresh generation. Numbers are drawn from
+ one counter and never reused, so a view that moves to another
+ window sees a different generation too.
+ 
+ Memoized queries remember their answer with the generation it was
+ computed under and a signature of the view's superview chain.
+ While both are unchanged, asking again costs a table lookup and a
+ walk up the ascent. A cached view answer is also dropped once it
+ leaves the queried view's subtree.
+ 
+ Subview changes are only seen after EnableViewGenerations(), which
+ swaps didAddSubview:, willRemoveSubview: and didMoveToSuperview
+ on every view in the process. A removal is bumped again from the
+ departing view's didMoveToSuperview once it has left. Subclasses
+ overriding any of these must call super, or their changes go
+ unseen. Without the hooks, moving the queried view is still caught
+ by the ascent check, but edits below it are not: call
+ BumpViewGeneration after changing the subtree. The pack never
+ enables the hooks itself.
+ 
+ Constraints added with raw addConstraint: or removeConstraint:
+ bypass the pack; call BumpViewGeneration yourself. Cached views
+ are held weakly; other answers are held until the next query or
+ a clear.
+ 
+ */
+
+// Swap in the hierarchy hooks, once per process
+void EnableViewGenerations(void);
+
+// The current generation of the view's window or root
+NSUInteger ViewGeneration(VIEW_CLASS *view);
+
+// Invalidate every memoized query in the view's window or root
+void BumpViewGeneration(VIEW_CLASS *view);
+
+// The answer query last gave for argument (may be nil) on view,
+// recomputed by block when the generation has moved on. Answers
+// may be nil. Equal arguments share an answer
+id MemoizedViewQuery(VIEW_CLASS *view, NSString *query, id argument, id (^block)(void));
+
+// Drop the view's memoized answers
+void ClearMemoizedViewQueries(VIEW_CLASS *view);
+
+#pragma mark - Cached Lookups
+@interface VIEW_CLASS (GenerationCache)
+- (VIEW_CLASS *) cachedViewWithNametag: (NSString *) aName;
+@end
@@ -0,0 +1,241 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#import "NametagUtilities.h"
+
+#if TARGET_OS_IPHONE
+@import ObjectiveC;
+#elif TARGET_OS_MAC
+#import <objc/objc-runtime.h>
+#endif
+
+#pragma mark - Generations
+
+// Hierarchy changes happen on the main thread, so plain
+// integers are enough
+static NSUInteger lastGeneration = 0;
+static char ViewGenerationKey;
+static char ViewMemoKey;
+static char PendingRemovalKey;
+
+@interface ViewGenerationRecord : NSObject
+{
+@public
+    NSUInteger generation;
+}
+@end
+
+@implementation ViewGenerationRecord
+@end
+
+// One record per window. On iOS the window is the root view,
+// on OS X the record hangs off the NSWindow
+static id GenerationOwner(VIEW_CLASS *view)
+{
+    id window = view.window;
+    if (window) return window;
+    
+    VIEW_CLASS *root = view;
+    while (root.superview)
+        root = root.superview;
+    return root;
+}
+
+static ViewGenerationRecord *GenerationRecord(id owner)
+{
+    ViewGenerationRecord *record = objc_getAssociatedObject(owner, &ViewGenerationKey);
+    if (!record)
+    {
+        record = [[ViewGenerationRecord alloc] init];
+        record->generation = ++lastGeneration;
+        objc_setAssociatedObject(owner, &ViewGenerationKey, record, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    return record;
+}
+
+NSUInteger ViewGeneration(VIEW_CLASS *view)
+{
+    if (!view) return 0;
+    return GenerationRecord(GenerationOwner(view))->generation;
+}
+
+void BumpViewGeneration(VIEW_CLASS *view)
+{
+    if (!view) return;
+    
+    // Records are created on demand, so an owner nobody has
+    // asked about has nothing to invalidate
+    ViewGenerationRecord *record = objc_getAssociatedObject(GenerationOwner(view), &ViewGenerationKey);
+    if (record)
+        record->generation = ++lastGeneration;
+}
+
+// A view joining or leaving a tree stops or starts being a
+// root. Any record it kept from an earlier stint as a root
+// no longer describes its subtree
+static void DropGenerationRecord(VIEW_CLASS *view)
+{
+    objc_setAssociatedObject(view, &ViewGenerationKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+#pragma mark - Memoization
+
+// One table per query. The whole table empties when
+// the generation or the view's ascent moves on. View answers
+// are held weakly: a view may answer a query about itself, and
+// a removed view should not outlive its last owner just for
+// being cached
+@interface ViewMemoTable : NSObject
+{
+@public
+    NSUInteger generation;
+    NSUInteger ascent;
+    NSMutableDictionary *answers;
+    NSMapTable *viewAnswers;
+}
+@end
+
+@implementation ViewMemoTable
+@end
+
+// Fold the superview chain into one word. Without the hierarchy
+// hooks nothing bumps on a move, so every lookup rechecks this
+static NSUInteger AscentSignature(VIEW_CLASS *view)
+{
+    NSUInteger signature = 0;
+    for (VIEW_CLASS *ancestor = view.superview; ancestor != nil; ancestor = ancestor.superview)
+        signature = signature * 31 + (NSUInteger) (__bridge void *) ancestor;
+    return signature;
+}
+
+id MemoizedViewQuery(VIEW_CLASS *view, NSString *query, id argument, id (^block)(void))
+{
+    if (!view || !query || !block) return nil;
+    
+    NSMutableDictionary *tables = objc_getAssociatedObject(view, &ViewMemoKey);
+    if (!tables)
+    {
+        tables = [NSMutableDictionary dictionary];
+        objc_setAssociatedObject(view, &ViewMemoKey, tables, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    
+    ViewMemoTable *table = tables[query];
+    if (!table)
+    {
+        table = [[ViewMemoTable alloc] init];
+        table->answers = [NSMutableDictionary dictionary];
+        table->viewAnswers = [NSMapTable strongToWeakObjectsMapTable];
+        tables[query] = table;
+    }
+    
+    NSUInteger generation = ViewGeneration(view);
+    NSUInteger ascent = AscentSignature(view);
+    if ((table->generation != generation) || (table->ascent != ascent))
+    {
+        [table->answers removeAllObjects];
+        [table->viewAnswers removeAllObjects];
+        table->generation = generation;
+        table->ascent = ascent;
+    }
+    
+    // A view answer that has since been released, or that has
+    // left the view's subtree, reads as missing and is recomputed
+    id key = argument ?: [NSNull null];
+    VIEW_CLASS *viewAnswer = [table->viewAnswers objectForKey:key];
+    if (viewAnswer && ![viewAnswer isDescendantOfView:view])
+        viewAnswer = nil;
+    id answer = viewAnswer ?: table->answers[key];
+    if (!answer)
+    {
+        answer = block() ?: [NSNull null];
+        if ([answer isKindOfClass:[VIEW_CLASS class]])
+            [table->viewAnswers setObject:answer forKey:key];
+        else
+            table->answers[key] = answer;
+    }
+    return (answer == [NSNull null]) ? nil : answer;
+}
+
+void ClearMemoizedViewQueries(VIEW_CLASS *view)
+{
+    objc_setAssociatedObject(view, &ViewMemoKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+#pragma mark - Hierarchy Hooks
+
+static void SwapInstanceMethods(Class class, SEL original, SEL replacement)
+{
+    Method originalMethod = class_getInstanceMethod(class, original);
+    Method replacementMethod = class_getInstanceMethod(class, replacement);
+    if (class_addMethod(class, original, method_getImplementation(replacementMethod), method_getTypeEncoding(replacementMethod)))
+        class_replaceMethod(class, replacement, method_getImplementation(originalMethod), method_getTypeEncoding(originalMethod));
+    else
+        method_exchangeImplementations(originalMethod, replacementMethod);
+}
+
+// Swapping is process-wide, so it waits to be asked for
+void EnableViewGenerations(void)
+{
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        Class class = [VIEW_CLASS class];
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wundeclared-selector"
+        SwapInstanceMethods(class, @selector(didAddSubview:), @selector(generation_didAddSubview:));
+        SwapInstanceMethods(class, @selector(willRemoveSubview:), @selector(generation_willRemoveSubview:));
+        SwapInstanceMethods(class, @selector(didMoveToSuperview), @selector(generation_didMoveToSuperview));
+#pragma GCC diagnostic pop
+    });
+}
+
+@implementation VIEW_CLASS (GenerationCache)
+// After swapping, these names call the original implementations
+- (void) generation_didAddSubview: (VIEW_CLASS *) subview
+{
+    BumpViewGeneration(self);
+    DropGenerationRecord(subview);
+    [self generation_didAddSubview:subview];
+}
+
+// The subview is still attached here, so a query run before the
+// removal completes would cache a stale answer under this bump.
+// Hand the record to the subview, which bumps it again once it
+// has actually left
+- (void) generation_willRemoveSubview: (VIEW_CLASS *) subview
+{
+    BumpViewGeneration(self);
+    ViewGenerationRecord *record = objc_getAssociatedObject(GenerationOwner(self), &ViewGenerationKey);
+    if (record)
+        objc_setAssociatedObject(subview, &PendingRemovalKey, record, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    DropGenerationRecord(subview);
+    [self generation_willRemoveSubview:subview];
+}
+
+- (void) generation_didMoveToSuperview
+{
+    ViewGenerationRecord *record = objc_getAssociatedObject(self, &PendingRemovalKey);
+    if (record)
+    {
+        record->generation = ++lastGeneration;
+        objc_setAssociatedObject(self, &PendingRemovalKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    [self generation_didMoveToSuperview];
+}
+
+// Renaming a view changes what viewWithNametag: finds
+- (void) setNametag: (NSString *) nametag
+{
+    [super setNametag:nametag];
+    BumpViewGeneration(self);
+}
+
+- (VIEW_CLASS *) cachedViewWithNametag: (NSString *) aName
+{
+    return MemoizedViewQuery(self, @"viewWithNametag:", aName, ^id{
+        return [self viewWithNametag:aName];
+    });
+}
+@end
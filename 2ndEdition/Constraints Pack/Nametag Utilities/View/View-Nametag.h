@@ -39,6 +39,8 @@
 @property (nonatomic, readonly) NSArray *nametags;
 - (VIEW_CLASS *) viewNamed: (NSString *) aName;
 - (NSArray *) viewsNamed: (NSString *) aName;
+- (VIEW_CLASS *) viewWithNametag: (NSString *) aName;
+- (NSArray *) viewsWithNametag: (NSString *) aName;
 @end
 
 /*
@@ -27,19 +27,21 @@
 {
     if (!aName) return nil;
     
-    // Is this the right view?
-    if ([self.nametag isEqualToString:aName])
-        return self;
+    // Nametags are atoms, so a name never interned matches nothing
+    NSString *atom = ExistingNametagAtom(aName);
+    if (!atom) return nil;
     
-    // Recurse depth first on subviews
-    for (VIEW_CLASS *subview in self.subviews)
-    {
-        VIEW_CLASS *resultView = [subview viewNamed:aName];
-        if (resultView) return resultView;
-    }
+    // Search depth first, starting with self
+    __block VIEW_CLASS *resultView = nil;
+    [self enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        if (view.nametag == atom)
+        {
+            resultView = view;
+            *stop = YES;
+        }
+    }];
     
-    // Not found
-    return nil;
+    return resultView;
 }
 
 // All matching views
@@ -48,16 +50,13 @@
     if (!aName) return nil;
     
     NSMutableArray *array = [NSMutableArray array];
-    if ([self.nametag isEqualToString:aName])
-        [array addObject:self];
+    NSString *atom = ExistingNametagAtom(aName);
+    if (!atom) return array;
     
-    // Recurse depth first on subviews
-    for (VIEW_CLASS *subview in self.subviews)
-    {
-        NSArray *results = [subview viewsNamed:aName];
-        if (results && results.count)
-            [array addObjectsFromArray:results];
-    }
+    [self enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        if (view.nametag == atom)
+            [array addObject:view];
+    }];
     
     return array;
 }
@@ -87,7 +86,7 @@
     return [NSString stringWithFormat:@"(%d %d; %d %d)" , (int) self.frame.origin.x, (int) self.frame.origin.y, (int) self.frame.size.width, (int) self.frame.size.height];
 }
 
-// Recursively travel down the view tree, increasing the indentation level for children
+// Describe one view, indented by its level in the tree
 - (void) dumpView: (VIEW_CLASS *) aView atIndent: (int) indent into:(NSMutableString *) outstring
 {
     for (int i = 0; i < indent; i++)
@@ -97,16 +96,16 @@
         [outstring appendFormat:@" [%@]", aView.nametag];
     [outstring appendFormat:@" %@" , aView.readableFrame];
     [outstring appendString:@"\n"];
-    for (VIEW_CLASS *view in aView.subviews)
-        [self dumpView:view atIndent:indent + 1 into:outstring];
 }
 
-// Start the tree recursion at level 0 with the root view
+// Travel down the view tree from level 0 at the root view
 - (NSString *) viewTree
 {
     NSMutableString *outstring = [NSMutableString string];
     [outstring appendString:@"\n"];
-    [self dumpView:self atIndent:0 into:outstring];
+    [self enumerateSubtreeUsingBlock:^(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop) {
+        [self dumpView:view atIndent:(int) depth into:outstring];
+    }];
     return outstring;
 }
 
@@ -0,0 +1,70 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#if TARGET_OS_IPHONE
+@import Foundation;
+#elif TARGET_OS_MAC
+#import <Foundation/Foundation.h>
+#endif
+
+#ifndef VIEW_CLASS
+#if TARGET_OS_IPHONE
+    @import UIKit;
+    #define VIEW_CLASS UIView
+    #define COLOR_CLASS UIColor
+    #define IMAGE_CLASS UIImage
+#elif TARGET_OS_MAC
+    #define VIEW_CLASS NSView
+    #define COLOR_CLASS NSColor
+    #define IMAGE_CLASS NSImage
+#endif
+#endif
+
+// If you use in production code, please make sure to add
+// namespace indicators to class category methods
+
+/*
+ 
+ Subtree Traversal
+ Walks a view and its descendants depth first using an explicit
+ stack rather than recursion. Each level works from a snapshot of
+ its subviews, so the block may safely add or remove views. Changes
+ show up the next time that level is entered.
+ 
+ The stack itself lives on the C stack for the first 32 levels and
+ on the heap past that, but the walk is not allocation-free: every
+ view entered copies its subviews array. If the stack cannot grow,
+ the walk logs an error and ends early.
+ 
+ */
+
+typedef enum
+{
+    ViewTraversalPreOrder = 0,        // Parents before children
+    ViewTraversalPostOrder = 1 << 0,  // Children before parents
+    ViewTraversalSkipRoot = 1 << 1,   // Descendants only
+} ViewTraversalOptions;
+
+// The root sits at depth 0, its subviews at depth 1
+#define ViewTraversalNoDepthLimit NSUIntegerMax
+
+// Set skipDescendants to prune the current view's subtree (pre-order only)
+typedef void (^ViewTraversalBlock)(VIEW_CLASS *view, NSUInteger depth, BOOL *skipDescendants, BOOL *stop);
+
+#pragma mark - Enumerator
+// Fast enumeration over a subtree
+@interface ViewSubtreeEnumerator : NSEnumerator
+@property (nonatomic, readonly) NSUInteger depth; // of the last object returned
+- (void) skipDescendants; // of the last object returned, pre-order only
+@end
+
+#pragma mark - Traversal
+@interface VIEW_CLASS (Traversal)
+- (void) enumerateSubtreeUsingBlock: (ViewTraversalBlock) block;
+- (void) enumerateSubtreeWithOptions: (ViewTraversalOptions) options maxDepth: (NSUInteger) maxDepth usingBlock: (ViewTraversalBlock) block;
+- (ViewSubtreeEnumerator *) subtreeEnumerator;
+- (ViewSubtreeEnumerator *) subtreeEnumeratorWithOptions: (ViewTraversalOptions) options maxDepth: (NSUInteger) maxDepth;
+@end
@@ -0,0 +1,279 @@
+/*
+ 
+ Erica Sadun, http://ericasadun.com
+ 
+ */
+
+#import "View-Traversal.h"
+
+#pragma mark - Traversal State
+
+// Typical view trees fit in the inline frames. Deeper trees
+// move the stack to the heap, doubling as needed
+#define TRAVERSAL_INLINE_FRAMES 32
+
+typedef struct
+{
+    __unsafe_unretained VIEW_CLASS *view;
+    CFArrayRef subviews; // retained snapshot
+    CFIndex index;
+    CFIndex count;
+    NSUInteger depth;
+} ViewTraversalFrame;
+
+typedef struct
+{
+    ViewTraversalFrame inlineFrames[TRAVERSAL_INLINE_FRAMES];
+    ViewTraversalFrame *frames;
+    NSUInteger top;
+    NSUInteger capacity;
+    
+    // Held alive by the caller
+    __unsafe_unretained VIEW_CLASS *root;
+    
+    // Last view handed out, not yet descended into. Held alive
+    // by its parent's snapshot or, for the root, by the caller
+    __unsafe_unretained VIEW_CLASS *pending;
+    NSUInteger pendingDepth;
+    BOOL skipPending;
+    
+    ViewTraversalOptions options;
+    NSUInteger maxDepth;
+    BOOL started;
+} ViewTraversal;
+
+static void ViewTraversalBegin(ViewTraversal *traversal, VIEW_CLASS *root, ViewTraversalOptions options, NSUInteger maxDepth)
+{
+    traversal->frames = traversal->inlineFrames;
+    traversal->top = 0;
+    traversal->capacity = TRAVERSAL_INLINE_FRAMES;
+    traversal->root = root;
+    traversal->pending = root;
+    traversal->pendingDepth = 0;
+    traversal->skipPending = NO;
+    traversal->options = options;
+    traversal->maxDepth = maxDepth;
+    traversal->started = NO;
+}
+
+// Release snapshots left behind by an early stop
+static void ViewTraversalEnd(ViewTraversal *traversal)
+{
+    while (traversal->top)
+        CFRelease(traversal->frames[--traversal->top].subviews);
+    if (traversal->frames != traversal->inlineFrames)
+        free(traversal->frames);
+    traversal->frames = traversal->inlineFrames;
+    traversal->pending = nil;
+}
+
+// Returns NO when the stack cannot grow. The traversal is
+// then ended, releasing its snapshots, and reports no more views
+static BOOL ViewTraversalPush(ViewTraversal *traversal, VIEW_CLASS *view, NSArray *subviews, NSUInteger depth)
+{
+    if (traversal->top == traversal->capacity)
+    {
+        NSUInteger capacity = traversal->capacity * 2;
+        size_t size = capacity * sizeof(ViewTraversalFrame);
+        ViewTraversalFrame *frames;
+        if (traversal->frames == traversal->inlineFrames)
+        {
+            frames = malloc(size);
+            if (frames)
+                memcpy(frames, traversal->inlineFrames, sizeof(traversal->inlineFrames));
+        }
+        else
+            frames = realloc(traversal->frames, size);
+    
+        // A failed realloc leaves the old block in place for End to free
+        if (!frames)
+        {
+            NSLog(@"Error: Out of memory growing the traversal stack past %lu levels.", (unsigned long) traversal->capacity);
+            ViewTraversalEnd(traversal);
+            return NO;
+        }
+        traversal->frames = frames;
+        traversal->capacity = capacity;
+    }
+    
+    ViewTraversalFrame *frame = &traversal->frames[traversal->top++];
+    frame->view = view;
+    frame->subviews = CFBridgingRetain(subviews);
+    frame->index = 0;
+    frame->count = (CFIndex) subviews.count;
+    frame->depth = depth;
+    return YES;
+}
+
+static BOOL ViewTraversalReports(ViewTraversal *traversal, VIEW_CLASS *view)
+{
+    return (view != traversal->root) || !(traversal->options & ViewTraversalSkipRoot);
+}
+
+// Prune the subtree of the view just returned
+static void ViewTraversalSkipPending(ViewTraversal *traversal)
+{
+    if (!(traversal->options & ViewTraversalPostOrder))
+        traversal->skipPending = YES;
+}
+
+// Step to the next view, or nil when the walk is done
+static VIEW_CLASS *ViewTraversalNext(ViewTraversal *traversal, NSUInteger *depth)
+{
+    BOOL postOrder = (traversal->options & ViewTraversalPostOrder) != 0;
+    
+    // Pre-order hands out the root before entering it
+    if (!traversal->started)
+    {
+        traversal->started = YES;
+        if (!postOrder && ViewTraversalReports(traversal, traversal->root))
+        {
+            if (depth) *depth = 0;
+            return traversal->root;
+        }
+    }
+    
+    while (YES)
+    {
+        // Enter the pending view unless pruned or too deep
+        if (traversal->pending)
+        {
+            VIEW_CLASS *view = traversal->pending;
+            NSUInteger viewDepth = traversal->pendingDepth;
+            BOOL descend = !traversal->skipPending && (viewDepth < traversal->maxDepth);
+            traversal->pending = nil;
+            traversal->skipPending = NO;
+    
+            NSArray *subviews = descend ? [view.subviews copy] : nil;
+            if (subviews.count)
+            {
+                if (!ViewTraversalPush(traversal, view, subviews, viewDepth))
+                    return nil;
+            }
+            else if (postOrder && ViewTraversalReports(traversal, view))
+            {
+                if (depth) *depth = viewDepth;
+                return view;
+            }
+            continue;
+        }
+    
+        if (!traversal->top)
+            return nil;
+    
+        // Hand out the next child at this level
+        ViewTraversalFrame *frame = &traversal->frames[traversal->top - 1];
+        if (frame->index < frame->count)
+        {
+            VIEW_CLASS *child = (__bridge VIEW_CLASS *) CFArrayGetValueAtIndex(frame->subviews, frame->index++);
+            traversal->pending = child;
+            traversal->pendingDepth = frame->depth + 1;
+            if (postOrder) continue;
+    
+            if (depth) *depth = traversal->pendingDepth;
+            return child;
+        }
+    
+        // Level exhausted. Post-order reports the parent now
+        VIEW_CLASS *view = frame->view;
+        NSUInteger viewDepth = frame->depth;
+        CFRelease(frame->subviews);
+        traversal->top--;
+    
+        if (postOrder && ViewTraversalReports(traversal, view))
+        {
+            if (depth) *depth = viewDepth;
+            return view;
+        }
+    }
+}
+
+#pragma mark - Enumerator
+
+@interface ViewSubtreeEnumerator ()
+{
+    ViewTraversal _traversal;
+    VIEW_CLASS *_root;
+    NSUInteger _depth;
+}
+@end
+
+@implementation ViewSubtreeEnumerator
+- (instancetype) initWithRoot: (VIEW_CLASS *) root options: (ViewTraversalOptions) options maxDepth: (NSUInteger) maxDepth
+{
+    if (!(self = [super init])) return self;
+    _root = root;
+    ViewTraversalBegin(&_traversal, _root, options, maxDepth);
+    return self;
+}
+
+- (void) dealloc
+{
+    ViewTraversalEnd(&_traversal);
+}
+
+- (id) nextObject
+{
+    if (!_root) return nil;
+    
+    VIEW_CLASS *view = ViewTraversalNext(&_traversal, &_depth);
+    if (!view)
+    {
+        // Done. Let go of the tree
+        ViewTraversalEnd(&_traversal);
+        _root = nil;
+    }
+    return view;
+}
+
+- (NSUInteger) depth
+{
+    return _depth;
+}
+
+- (void) skipDescendants
+{
+    ViewTraversalSkipPending(&_traversal);
+}
+@end
+
+#pragma mark - Traversal
+
+@implementation VIEW_CLASS (Traversal)
+- (void) enumerateSubtreeWithOptions: (ViewTraversalOptions) options maxDepth: (NSUInteger) maxDepth usingBlock: (ViewTraversalBlock) block
+{
+    if (!block) return;
+    
+    ViewTraversal traversal;
+    ViewTraversalBegin(&traversal, self, options, maxDepth);
+    
+    BOOL stop = NO;
+    NSUInteger depth = 0;
+    VIEW_CLASS *view;
+    while (!stop && (view = ViewTraversalNext(&traversal, &depth)))
+    {
+        BOOL skipDescendants = NO;
+        block(view, depth, &skipDescendants, &stop);
+        if (skipDescendants)
+            ViewTraversalSkipPending(&traversal);
+    }
+    
+    ViewTraversalEnd(&traversal);
+}
+
+// Pre-order, root included, no depth limit
+- (void) enumerateSubtreeUsingBlock: (ViewTraversalBlock) block
+{
+    [self enumerateSubtreeWithOptions:ViewTraversalPreOrder maxDepth:ViewTraversalNoDepthLimit usingBlock:block];
+}
+
+- (ViewSubtreeEnumerator *) subtreeEnumeratorWithOptions: (ViewTraversalOptions) options maxDepth: (NSUInteger) maxDepth
+{
+    return [[ViewSubtreeEnumerator alloc] initWithRoot:self options:options maxDepth:maxDepth];
+}
+
+- (ViewSubtreeEnumerator *) subtreeEnumerator
+{
+    return [self subtreeEnumeratorWithOptions:ViewTraversalPreOrder maxDepth:ViewTraversalNoDepthLimit];
+}
+@end
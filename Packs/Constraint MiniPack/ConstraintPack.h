@@ -64,6 +64,10 @@ void RemoveConstraints(NSArray *constraints);
 
 /*
  CONSTRAINT REFERENCES
+ External references scan every superview's constraints on each call,
+ so they see constraints however they were activated and drop those
+ UIKit and AppKit remove along with a view. Cost grows with the
+ constraints held along the ascent; cache results in hot loops.
  */
 @interface View (ConstraintPack)
 @property (nonatomic, readonly) NSArray *externalConstraintReferences;
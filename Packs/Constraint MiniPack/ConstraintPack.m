@@ -19,40 +19,40 @@
     #define Font NSFont
 #endif
 
+// Count superviews with a direct pointer walk
+static NSUInteger ViewDepth(View *view)
+{
+    NSUInteger depth = 0;
+    for (View *ancestor = view.superview; ancestor != nil; ancestor = ancestor.superview)
+        depth++;
+    return depth;
+}
+
 // Return nearest common ancestor between two views
+// Level the deeper view up to the shallower one, then walk both
+// upward together. No arrays are built along the way.
 View *NearestCommonViewAncestor(View *view1, View *view2)
 {
     if (!view1 || !view2) return nil;
     
     if ([view1 isEqual:view2]) return view1;
     
-    // Collect superviews
-    View *view;
-    NSMutableArray *array1 = [NSMutableArray arrayWithObject:view1];
-    view = view1.superview;
-    while (view != nil)
-    {
-        [array1 addObject:view];
-        view = view.superview;
-    }
+    NSUInteger depth1 = ViewDepth(view1);
+    NSUInteger depth2 = ViewDepth(view2);
+    
+    for (; depth1 > depth2; depth1--)
+        view1 = view1.superview;
+    for (; depth2 > depth1; depth2--)
+        view2 = view2.superview;
     
-    NSMutableArray *array2 = [NSMutableArray arrayWithObject:view2];
-    view = view2.superview;
-    while (view != nil)
+    // Handles superview relationships and indirect ancestors alike
+    while (view1 != view2)
     {
-        [array2 addObject:view];
-        view = view.superview;
+        view1 = view1.superview;
+        view2 = view2.superview;
     }
     
-    // Check for superview relationships
-    if ([array1 containsObject:view2]) return view2;
-    if ([array2 containsObject:view1]) return view1;
-    
-    // Check for indirect ancestor
-    for (View *view in array1)
-        if ([array2 containsObject:view]) return view;
-    
-    return nil;
+    return view1;
 }
 
 // For iOS 8 and later, you can simply set a constraint's active property to YES and it will self-install. Set active to NO and it uninstalls.